@@ -11,13 +11,41 @@
 
 #include <stdlib.h>     /* abs */
 #include "node.h"
+#include "landmark.h"
+
+/* Step costs of 8-connected mazes, straight and diagonal. */
+#define COMPASS_STRAIGHT    (10)
+#define COMPASS_DIAGONAL    (14)
+
+/* Plain manhattan distance, for kernels that never load landmarks. */
+#define heuristic_manhattan(n1, n2)     (abs((n1)->x - (n2)->x) + abs((n1)->y - (n2)->y))
+
+/* Landmark distance fields tightening the heuristic, NULL if not used. */
+const landmark_t *compass_landmarks = NULL;
 
 /**
- * Heuristic function, using simply manhattan distance between N1 and N2.
- *   Returns the distance (i.e. h(n1, n2)).
+ * Heuristic function, using manhattan distance between N1 and N2, raised to
+ *   the landmark (ALT) lower bound when landmarks are loaded. Both bounds are
+ *   admissible, so is their maximum. Returns the distance (i.e. h(n1, n2)).
  */
 int heuristic(node_t *n1, node_t *n2) {
-    return abs(n1->x - n2->x) + abs(n1->y - n2->y);
+    int h = abs(n1->x - n2->x) + abs(n1->y - n2->y);
+    if (compass_landmarks != NULL) {
+        int bound = landmark_bound(compass_landmarks, n1->x, n1->y, n2->x, n2->y);
+        if (bound > h) h = bound;
+    }
+    return h;
+}
+
+/**
+ * Heuristic function of 8-connected mazes, using octile distance between N1
+ *   and N2: diagonal steps while both axes differ, then straight ones.
+ *   Returns the distance in step costs.
+ */
+int heuristic_octile(node_t *n1, node_t *n2) {
+    int dx = abs(n1->x - n2->x), dy = abs(n1->y - n2->y);
+    if (dx < dy) return COMPASS_DIAGONAL * dx + COMPASS_STRAIGHT * (dy - dx);
+    return COMPASS_DIAGONAL * dy + COMPASS_STRAIGHT * (dx - dy);
 }
 
 #endif
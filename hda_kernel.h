@@ -0,0 +1,319 @@
+/**
+ * File: hda_kernel.h
+ *
+ *   Template of the HDA* search kernel, included by main.c once per
+ *     connectivity and heuristic combination. Before each inclusion define:
+ *
+ *         HDA_KERNEL_SUFFIX       suffix of the generated function names
+ *         HDA_KERNEL_HEURISTIC    heuristic(n1, n2) of compass.h
+ *         HDA_KERNEL_EXPAND       HDA_EXPAND_4 or HDA_EXPAND_8
+ *
+ *     and optionally, for sparse mazes:
+ *
+ *         HDA_KERNEL_GET          maze_sparse_get, maze_node by default
+ *         HDA_KERNEL_PUT          maze_sparse_put, maze_node_put by default
+ *
+ *     and, where a direction must stay exhaustive up to the bound:
+ *
+ *         HDA_KERNEL_THROUGH      1 to expand through meeting cells, 0 by
+ *                                 default
+ *
+ *     The neighbour checks are unrolled and the heuristic is bound at
+ *     compile time, so the inner loop of a kernel never branches on the
+ *     connectivity. The parameters are undefined at the end.
+ */
+
+#ifndef _HDA_KERNEL_H_
+#define _HDA_KERNEL_H_
+
+#define HDA_CAT_(a, b)          a##b
+#define HDA_CAT(a, b)           HDA_CAT_(a, b)
+#define HDA_KERNEL_NAME(name)   HDA_CAT(name, HDA_KERNEL_SUFFIX)
+
+#define HDA_OPEN(to_x, to_y)    (maze_lines(args->file, to_x, to_y) != '#')
+
+/**
+ * Send cell (TO_X, TO_Y) with g-score TO_GS through NODE to the thread
+ *   owning it, unless this thread already knows it as good.
+ */
+#define HDA_SEND(to_x, to_y, to_gs) do { \
+    int send_x = (to_x), send_y = (to_y), send_gs = (to_gs); \
+    node_t *origin = HDA_KERNEL_GET(args->maze, send_x, send_y); \
+    if (origin == NULL || send_gs < origin->gs) { \
+        hda_mq_t *mq = &args->mqs[hash_distribute(args->thread_num, send_x, send_y)]; \
+        hda_message_t *new_msg = alloc_msg(msg_queue); \
+        new_msg->parent = node; \
+        new_msg->x = send_x; \
+        new_msg->y = send_y; \
+        new_msg->gs = send_gs; \
+        if (args->trace != NULL) { \
+            new_msg->stamp = trace_clock(args->trace); \
+            trace_record(args->trace, new_msg->stamp, TRACE_SEND, send_x, send_y, send_gs, \
+                         (int) (mq - args->mqs), args->state->heap.size - 1); \
+        } \
+        /* message sent add one */ \
+        ++*msg_sent; \
+        /* send message. */ \
+        do { \
+            new_msg->next = mq->head; \
+        } while (!__atomic_compare_exchange_n(&mq->head, &new_msg->next, new_msg, 1, \
+                                              __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)); \
+    } \
+} while (0)
+
+/* 4-connected, unit steps. */
+#define HDA_EXPAND_4(node) do { \
+    if (HDA_OPEN((node)->x + 1, (node)->y)) HDA_SEND((node)->x + 1, (node)->y, (node)->gs + 1); \
+    if (HDA_OPEN((node)->x - 1, (node)->y)) HDA_SEND((node)->x - 1, (node)->y, (node)->gs + 1); \
+    if (HDA_OPEN((node)->x, (node)->y + 1)) HDA_SEND((node)->x, (node)->y + 1, (node)->gs + 1); \
+    if (HDA_OPEN((node)->x, (node)->y - 1)) HDA_SEND((node)->x, (node)->y - 1, (node)->gs + 1); \
+} while (0)
+
+/* 8-connected with octile costs. A diagonal step may not cut a corner, so
+ * both cells beside it must be open. */
+#define HDA_EXPAND_8(node) do { \
+    int east = HDA_OPEN((node)->x + 1, (node)->y), west = HDA_OPEN((node)->x - 1, (node)->y); \
+    int south = HDA_OPEN((node)->x, (node)->y + 1), north = HDA_OPEN((node)->x, (node)->y - 1); \
+    if (east) HDA_SEND((node)->x + 1, (node)->y, (node)->gs + COMPASS_STRAIGHT); \
+    if (west) HDA_SEND((node)->x - 1, (node)->y, (node)->gs + COMPASS_STRAIGHT); \
+    if (south) HDA_SEND((node)->x, (node)->y + 1, (node)->gs + COMPASS_STRAIGHT); \
+    if (north) HDA_SEND((node)->x, (node)->y - 1, (node)->gs + COMPASS_STRAIGHT); \
+    if (east && south && HDA_OPEN((node)->x + 1, (node)->y + 1)) \
+        HDA_SEND((node)->x + 1, (node)->y + 1, (node)->gs + COMPASS_DIAGONAL); \
+    if (east && north && HDA_OPEN((node)->x + 1, (node)->y - 1)) \
+        HDA_SEND((node)->x + 1, (node)->y - 1, (node)->gs + COMPASS_DIAGONAL); \
+    if (west && south && HDA_OPEN((node)->x - 1, (node)->y + 1)) \
+        HDA_SEND((node)->x - 1, (node)->y + 1, (node)->gs + COMPASS_DIAGONAL); \
+    if (west && north && HDA_OPEN((node)->x - 1, (node)->y - 1)) \
+        HDA_SEND((node)->x - 1, (node)->y - 1, (node)->gs + COMPASS_DIAGONAL); \
+} while (0)
+
+#endif
+
+#ifndef HDA_KERNEL_GET
+#define HDA_KERNEL_GET          maze_node
+#define HDA_KERNEL_PUT          maze_node_put
+#endif
+
+#ifndef HDA_KERNEL_THROUGH
+#define HDA_KERNEL_THROUGH      0
+#endif
+
+/**
+ * Rekey the open nodes with the current weight and reopen the nodes set
+ *   aside by the previous round. Each reopened node counts as a message
+ *   sent, as on its first insertion.
+ */
+static void HDA_KERNEL_NAME(hda_reopen)(hda_argument_t *args) {
+    hda_state_t *state = args->state;
+    int open = state->heap.size - 1, j;
+    size_t i;
+    /* nodes left open when the other direction ended the round, rebuilt in
+     * place: the J-th insertion never writes past slot J + 1. */
+    state->heap.size = 1;
+    for (j = 1; j <= open; j++) {
+        node_t *node = state->heap.nodes[j];
+        node->fs = weighted_f(node->gs, HDA_KERNEL_HEURISTIC(node, get_goal(args->maze)), args->weight);
+        heap_insert(&state->heap, node);
+    }
+    for (i = 0; i < state->incons_len; i++) {
+        node_t *node = state->incons[i];
+        /* already reopened by an improvement. */
+        if (node->heap_id != 0) continue;
+        node->fs = weighted_f(node->gs, HDA_KERNEL_HEURISTIC(node, get_goal(args->maze)), args->weight);
+        heap_insert(&state->heap, node);
+        ++args->msg_sent[args->thread_id];
+    }
+    state->incons_len = 0;
+}
+
+void *HDA_KERNEL_NAME(hda_star_search)(hda_argument_t *args) {
+    mem_pool_t *mem_pool = &args->state->mem_pool;
+    heap_t *heap = &args->state->heap;
+    node_t *node, *other_node;
+    int other_gs;
+    hda_message_t *msg_start, *msg, *next_msg;
+    unsigned long received_at = 0;
+    size_t *msg_sent = &args->msg_sent[args->thread_id];
+    size_t *msg_received = &args->msg_received[args->thread_id];
+    hda_mq_t *msg_queue = &args->mqs[args->thread_id];
+
+    /* add start, unless a previous round did. */
+    if (hash_distribute(args->thread_num, args->maze->start_x, args->maze->start_y) ==
+        args->thread_id && HDA_KERNEL_GET(args->maze, args->maze->start_x, args->maze->start_y) == NULL) {
+        /* initialize first node. */
+        ++*msg_sent;
+        node = node_init(alloc_node(mem_pool), args->maze->start_x, args->maze->start_y);
+        node->gs = 1;
+        node->fs = weighted_f(1, HDA_KERNEL_HEURISTIC(node, get_goal(args->maze)), args->weight);
+        if (args->targets != NULL) hda_reach(args, node, 1);
+        if (args->other_maze == NULL) {
+            /* a single direction never meets: once the start is counted as
+             * sent, quiescence alone may end the search. */
+            pthread_mutex_lock(args->return_value_mutex);
+            if (args->return_value->min_len == INT_MAX) args->return_value->min_len = INT_MAX - 1;
+            pthread_mutex_unlock(args->return_value_mutex);
+        }
+        /* modify maze.nodes. */
+        HDA_KERNEL_PUT(args->maze, args->maze->start_x, args->maze->start_y, node);
+        /* insert first node. */
+        heap_insert(heap, node);
+    }
+    HDA_KERNEL_NAME(hda_reopen)(args);
+    hda_trace(args, TRACE_BEGIN, -1, -1, 0, 0);
+
+    /* main loop. */
+    while (!*args->finished) {
+        if (heap->size > 1) {
+            /* if there are nodes in heap. */
+            node = heap_extract(heap);
+            /* if the node is worse than currently found best path. An anytime
+             * round stops on the f-score and keeps the nodes for the next. */
+            if (args->keep ? node->fs >= args->return_value->min_len
+                           : node->gs >= args->return_value->min_len) {
+                int i;
+                if (args->keep) hda_keep(args->state, node);
+                for (i = 1; i < heap->size; i++) {
+                    heap->nodes[i]->heap_id = 0;
+                    if (args->keep) hda_keep(args->state, heap->nodes[i]);
+                }
+                /* dump heap and add number of nodes to message received. */
+                *msg_received += heap->size;
+                heap->size = 1;
+                continue;
+            }
+            /* one step further could wrap the g-scores, or their sum at a
+             * meeting: give up on a path this long rather than miss it. */
+            if (node->gs > HDA_GS_MAX) {
+                pthread_mutex_lock(args->return_value_mutex);
+                args->return_value->overflow = 1;
+                pthread_mutex_unlock(args->return_value_mutex);
+                *args->finished = 1;
+                goto hda_star_search_end;
+            }
+            /* if the node is opened in another list. */
+            other_node = args->other_maze == NULL ? NULL :
+                         HDA_KERNEL_GET(args->other_maze, node->x, node->y);
+            /* a node the other direction has just allocated has no g-score yet,
+             * and adding INT_MAX would wrap the bound. */
+            other_gs = other_node == NULL ? INT_MAX :
+                       __atomic_load_n(&other_node->gs, __ATOMIC_RELAXED);
+            if (other_gs < INT_MAX) {
+                int last_len, len = node->gs + other_gs;
+                /* update current best path. */
+                pthread_mutex_lock(args->return_value_mutex);
+                last_len = args->return_value->min_len;
+                if (len < last_len) {
+                    args->return_value->min_len = len;
+                    args->return_value->x = node->x;
+                    args->return_value->y = node->y;
+                }
+                pthread_mutex_unlock(args->return_value_mutex);
+            }
+            /* anytime rounds also expand through the meeting point, since the
+             * other direction may hold it with a g-score from a heavier round.
+             * So do kernels with unequal step costs, where stopping at a
+             * meeting cell may cut the shortest path off. */
+            if (other_gs == INT_MAX || args->keep || HDA_KERNEL_THROUGH) {
+                hda_trace(args, TRACE_EXPAND, node->x, node->y, node->gs, node->fs);
+                HDA_KERNEL_EXPAND(node);
+            }
+            /* message received add one */
+            ++*msg_received;
+        } else {
+            /* no nodes in heap. */
+            int idle = msg_queue->head == NULL;
+            if (idle) hda_trace(args, TRACE_IDLE, -1, -1, 0, 0);
+            while (msg_queue->head == NULL) {
+                size_t msg_sent_sum = 0, msg_received_sum = 0, i;
+                /* the bound is read first, so the start it may depend on is
+                 * already counted in the sums. */
+                int bounded = __atomic_load_n(&args->return_value->min_len, __ATOMIC_ACQUIRE) < INT_MAX;
+                /* barrier hit. If end, thread will stuck here and wait for cancel. */
+                for (i = 0; i < args->thread_num; i++)
+                    msg_received_sum += args->msg_received[i];
+                for (i = 0; i < args->thread_num; i++)
+                    msg_sent_sum += args->msg_sent[i];
+                /* unbounded, both directions running dry after counting their
+                 * starts means they never met: the goal is unreachable. */
+                if (!bounded && args->other_msg_sent != NULL && msg_sent_sum > 0 &&
+                    msg_sent_sum == msg_received_sum) {
+                    size_t other_sent_sum = 0, other_received_sum = 0;
+                    for (i = 0; i < args->thread_num; i++)
+                        other_received_sum += args->other_msg_received[i];
+                    for (i = 0; i < args->thread_num; i++)
+                        other_sent_sum += args->other_msg_sent[i];
+                    bounded = other_sent_sum > 0 && other_sent_sum == other_received_sum;
+                }
+                if (*args->finished || (bounded && msg_sent_sum == msg_received_sum)) {
+                    *args->finished = 1;
+                    goto hda_star_search_end;
+                }
+            }
+            if (idle) hda_trace(args, TRACE_BUSY, -1, -1, 0, 0);
+        }
+        /* receive message. */
+		msg_start = __atomic_exchange_n(&msg_queue->head, NULL, __ATOMIC_ACQUIRE);
+		/*
+        msg_start = NULL;
+        __asm__ __volatile__(
+        "lock   xchg        %[msg], %E[ptr];    "
+        :[msg] "+r"(msg_start)
+        :[ptr] "r"(&msg_queue->head)
+        : "memory");
+		*/
+
+        msg = msg_start;
+        /* the whole batch arrived at once. */
+        if (msg != NULL && args->trace != NULL) received_at = trace_clock(args->trace);
+        if (msg != NULL) {
+            /* add all nodes in message queue. */
+            while (1) {
+                node_t *adj = HDA_KERNEL_GET(args->maze, msg->x, msg->y);
+                /* if NULL, the node is not opened */
+                if (adj == NULL) {
+                    /* allocate new node and modify maze.nodes. */
+                    adj = node_init(alloc_node(mem_pool), msg->x, msg->y);
+                    HDA_KERNEL_PUT(args->maze, msg->x, msg->y, adj);
+                }
+
+                /* update if improved. */
+                if (msg->gs < adj->gs) {
+                    /* modify node. */
+                    if (args->targets != NULL) hda_reach(args, adj, msg->gs);
+                    adj->parent = msg->parent;
+                    adj->gs = msg->gs;
+                    adj->fs = weighted_f(adj->gs, HDA_KERNEL_HEURISTIC(adj, get_goal(args->maze)), args->weight);
+                    if (adj->heap_id != 0) {
+                        heap_update(heap, adj);
+                        ++*msg_received;
+                    } else {
+                        heap_insert(heap, adj);
+                    }
+                } else {
+                    ++*msg_received;
+                }
+                if (args->trace != NULL) {
+                    unsigned long latency = received_at - msg->stamp;
+                    trace_record(args->trace, received_at, TRACE_RECEIVE, msg->x, msg->y, msg->gs,
+                                 latency > INT_MAX ? INT_MAX : (int) latency, heap->size - 1);
+                }
+                next_msg = msg->next;
+                if (next_msg == NULL) break;
+                msg = next_msg;
+            }
+            free_msg(msg_queue, msg_start, msg);
+        }
+    }
+
+    hda_star_search_end:
+    hda_trace(args, TRACE_END, -1, -1, 0, 0);
+    return NULL;
+}
+
+#undef HDA_KERNEL_SUFFIX
+#undef HDA_KERNEL_HEURISTIC
+#undef HDA_KERNEL_EXPAND
+#undef HDA_KERNEL_GET
+#undef HDA_KERNEL_PUT
+#undef HDA_KERNEL_THROUGH
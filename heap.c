@@ -89,3 +89,35 @@ void heap_update(heap_t *heap, node_t *node) {
     heap->nodes[cur] = node;
     node->heap_id = cur;
 }
+
+/**
+ * Remove node N from the min heap H, wherever it lays.
+ */
+void heap_remove(heap_t *heap, node_t *node) {
+    node_t *last = heap->nodes[--heap->size];
+    int cur = node->heap_id, child;
+    node->heap_id = 0;
+    if (last == node) return;
+    /* LAST takes the hole, then floats up or sinks down. */
+    if (cur > 1 && node_less(last, heap->nodes[cur / 2])) {
+        do {
+            heap->nodes[cur] = heap->nodes[cur / 2];
+            heap->nodes[cur]->heap_id = cur;
+            cur /= 2;
+        } while (cur > 1 && node_less(last, heap->nodes[cur / 2]));
+    } else {
+        for (; 2 * cur < heap->size; cur = child) {
+            child = 2 * cur;
+            if (child + 1 < heap->size && node_less(heap->nodes[child + 1], heap->nodes[child]))
+                child++;
+            if (node_less(heap->nodes[child], last)) {
+                heap->nodes[cur] = heap->nodes[child];
+                heap->nodes[cur]->heap_id = cur;
+            } else {
+                break;
+            }
+        }
+    }
+    heap->nodes[cur] = last;
+    last->heap_id = cur;
+}
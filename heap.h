@@ -37,4 +37,6 @@ void heap_insert(heap_t *heap, node_t *node);
 
 void heap_update(heap_t *heap, node_t *node);
 
+void heap_remove(heap_t *heap, node_t *node);
+
 #endif
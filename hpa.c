@@ -0,0 +1,636 @@
+/**
+ * File: hpa.c
+ *
+ *   Implementation of the hierarchical abstraction index. Building it runs
+ *     one BFS per entrance restricted to its cluster, clusters being shared
+ *     out among threads. A query only searches the abstract graph and then
+ *     refines the clusters crossed by the abstract path.
+ */
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdio.h>      /* FILE, fopen, fread, fwrite, fseek */
+#include <stdlib.h>     /* malloc, calloc, realloc, free */
+#include <limits.h>     /* INT_MAX */
+#include <assert.h>     /* assert */
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "hpa.h"
+#include "heap.h"
+#include "node.h"
+
+#define HPA_HEADER              (11)
+
+typedef struct hpa_worker_t {
+    hpa_t *hpa;
+    const maze_file_t *file;
+    int *next_cluster;      /* Shared counter of clusters handed out. */
+    int *degrees;           /* Edges found so far for each entrance. */
+} hpa_worker_t;
+
+/**
+ * Bounds of cluster C: top left corner (X0, Y0), width W and height H.
+ */
+static void hpa_bounds(const hpa_t *hpa, int c, int *x0, int *y0, int *w, int *h) {
+    *x0 = c % hpa->cluster_cols * hpa->cluster;
+    *y0 = c / hpa->cluster_cols * hpa->cluster;
+    *w = hpa->cols - *x0 < hpa->cluster ? hpa->cols - *x0 : hpa->cluster;
+    *h = hpa->rows - *y0 < hpa->cluster ? hpa->rows - *y0 : hpa->cluster;
+}
+
+/**
+ * Find the entrance at (X, Y) in cluster C. Returns its index, -1 if none.
+ */
+static int hpa_find(const hpa_t *hpa, int c, int x, int y) {
+    int e;
+    for (e = hpa->cluster_offsets[c]; e < hpa->cluster_offsets[c + 1]; e++)
+        if (hpa->xs[e] == x && hpa->ys[e] == y) return e;
+    return -1;
+}
+
+/**
+ * Fill KEY with the size and the modification time of the maze FILE, which
+ *   change whenever the maze is rewritten. Returns 0 on success, -1 if the
+ *   file cannot be inspected.
+ */
+static int hpa_key(const maze_file_t *file, int *key) {
+    struct stat status;
+    if (fstat(file->fd, &status) == -1) return -1;
+    key[0] = (int) ((unsigned long) status.st_size & 0xffffffffUL);
+    key[1] = (int) ((unsigned long) status.st_size >> 32);
+    key[2] = (int) ((unsigned long) status.st_mtim.tv_sec & 0xffffffffUL);
+    key[3] = (int) ((unsigned long) status.st_mtim.tv_sec >> 32);
+    key[4] = (int) status.st_mtim.tv_nsec;
+    return 0;
+}
+
+/**
+ * BFS from (SX, SY) without leaving cluster C. DIST receives the distances
+ *   indexed by position inside the cluster, -1 if unreachable. QUEUE is a
+ *   scratch buffer as large as a cluster.
+ */
+static void hpa_cluster_bfs(const hpa_t *hpa, const maze_file_t *file, int c, int sx, int sy,
+                            int *dist, int *queue) {
+    int x0, y0, w, h, head = 0, tail = 0, i;
+    hpa_bounds(hpa, c, &x0, &y0, &w, &h);
+    for (i = 0; i < w * h; i++)
+        dist[i] = -1;
+    dist[(sy - y0) * w + sx - x0] = 0;
+    queue[tail++] = (sy - y0) * w + sx - x0;
+    while (head < tail) {
+        int cur = queue[head++];
+        int x = cur % w, y = cur / w;
+        int x_axis[4], y_axis[4];
+        x_axis[0] = x + 1;
+        y_axis[0] = y;
+        x_axis[1] = x - 1;
+        y_axis[1] = y;
+        x_axis[2] = x;
+        y_axis[2] = y + 1;
+        x_axis[3] = x;
+        y_axis[3] = y - 1;
+        for (i = 0; i < 4; i++) {
+            int local = y_axis[i] * w + x_axis[i];
+            if (x_axis[i] < 0 || x_axis[i] >= w || y_axis[i] < 0 || y_axis[i] >= h) continue;
+            if (maze_lines(file, x0 + x_axis[i], y0 + y_axis[i]) == '#' || dist[local] != -1)
+                continue;
+            dist[local] = dist[cur] + 1;
+            queue[tail++] = local;
+        }
+    }
+}
+
+/**
+ * Add (X, Y) to the entrances of cluster C, the last cluster collected so
+ *   far, unless it already is one. CAPACITY is that of the entrance arrays.
+ */
+static void hpa_add(hpa_t *hpa, int c, int x, int y, int *capacity) {
+    int e;
+    for (e = hpa->cluster_offsets[c]; e < hpa->entrance_num; e++)
+        if (hpa->xs[e] == x && hpa->ys[e] == y) return;
+    if (hpa->entrance_num == *capacity) {
+        *capacity *= 2;
+        hpa->xs = realloc(hpa->xs, *capacity * sizeof(int));
+        hpa->ys = realloc(hpa->ys, *capacity * sizeof(int));
+        assert(hpa->xs != NULL && hpa->ys != NULL);
+    }
+    hpa->xs[hpa->entrance_num] = x;
+    hpa->ys[hpa->entrance_num] = y;
+    hpa->entrance_num++;
+}
+
+/**
+ * Add the entrances of cluster C on its side towards (DX, DY): the middle
+ *   cell of every run of open cell pairs across that border, or both end
+ *   cells of a run longer than HPA_RUN_SPLIT. The cluster beyond walks the
+ *   same pairs in the same order, so it picks the matching cells.
+ */
+static void hpa_add_side(hpa_t *hpa, const maze_file_t *file, int c, int dx, int dy,
+                         int *capacity) {
+    int x0, y0, w, h, x, y, len, i, run = 0;
+    hpa_bounds(hpa, c, &x0, &y0, &w, &h);
+    /* first cell of the side, walked along y for a vertical border. */
+    x = dx > 0 ? x0 + w - 1 : x0;
+    y = dy > 0 ? y0 + h - 1 : y0;
+    len = dx != 0 ? h : w;
+    if (x + dx < 0 || x + dx >= hpa->cols || y + dy < 0 || y + dy >= hpa->rows) return;
+    for (i = 0; i <= len; i++) {
+        int cx = dx != 0 ? x : x + i, cy = dx != 0 ? y + i : y;
+        if (i < len && maze_lines(file, cx, cy) != '#' && maze_lines(file, cx + dx, cy + dy) != '#') {
+            run++;
+            continue;
+        }
+        if (run > HPA_RUN_SPLIT) {
+            hpa_add(hpa, c, dx != 0 ? x : x + i - run, dx != 0 ? y + i - run : y, capacity);
+            hpa_add(hpa, c, dx != 0 ? x : x + i - 1, dx != 0 ? y + i - 1 : y, capacity);
+        } else if (run > 0) {
+            int mid = i - run + (run - 1) / 2;
+            hpa_add(hpa, c, dx != 0 ? x : x + mid, dx != 0 ? y + mid : y, capacity);
+        }
+        run = 0;
+    }
+}
+
+static void *hpa_build_worker(hpa_worker_t *worker) {
+    hpa_t *hpa = worker->hpa;
+    int size = hpa->cluster * hpa->cluster;
+    int *dist = malloc(size * sizeof(int));
+    int *queue = malloc(size * sizeof(int));
+    int c;
+    assert(dist != NULL && queue != NULL);
+    while ((c = __atomic_fetch_add(worker->next_cluster, 1, __ATOMIC_RELAXED)) <
+           hpa->cluster_rows * hpa->cluster_cols) {
+        int x0, y0, w, h, e, f;
+        hpa_bounds(hpa, c, &x0, &y0, &w, &h);
+        for (e = hpa->cluster_offsets[c]; e < hpa->cluster_offsets[c + 1]; e++) {
+            int x = hpa->xs[e], y = hpa->ys[e], i;
+            int *targets = hpa->targets + hpa->offsets[e];
+            int *weights = hpa->weights + hpa->offsets[e];
+            int *degree = &worker->degrees[e];
+            int x_axis[4], y_axis[4];
+            /* intra-cluster edges. */
+            hpa_cluster_bfs(hpa, worker->file, c, x, y, dist, queue);
+            for (f = hpa->cluster_offsets[c]; f < hpa->cluster_offsets[c + 1]; f++) {
+                int d = dist[(hpa->ys[f] - y0) * w + hpa->xs[f] - x0];
+                if (f == e || d < 0) continue;
+                targets[*degree] = f;
+                weights[*degree] = d;
+                ++*degree;
+            }
+            /* inter-cluster edges, to whichever neighbour is an entrance too. */
+            x_axis[0] = x + 1;
+            y_axis[0] = y;
+            x_axis[1] = x - 1;
+            y_axis[1] = y;
+            x_axis[2] = x;
+            y_axis[2] = y + 1;
+            x_axis[3] = x;
+            y_axis[3] = y - 1;
+            for (i = 0; i < 4; i++) {
+                int other = hpa_cluster_of(hpa, x_axis[i], y_axis[i]), to;
+                if (other == c || maze_lines(worker->file, x_axis[i], y_axis[i]) == '#') continue;
+                to = hpa_find(hpa, other, x_axis[i], y_axis[i]);
+                if (to < 0) continue;
+                targets[*degree] = to;
+                weights[*degree] = 1;
+                ++*degree;
+            }
+        }
+    }
+    free(dist);
+    free(queue);
+    return NULL;
+}
+
+/**
+ * Build the abstract graph of maze FILE with clusters of side CLUSTER, using
+ *   THREAD_NUM threads. Returns the pointer to the new index.
+ */
+hpa_t *hpa_init(const maze_file_t *file, int cluster, size_t thread_num) {
+    hpa_t *hpa = malloc(sizeof(hpa_t));
+    pthread_t *threads;
+    hpa_worker_t *workers;
+    int *degrees, *bound_offsets;
+    int clusters, capacity = INIT_CAPACITY, next_cluster = 0;
+    int c, e, i;
+    size_t t;
+    assert(hpa != NULL && cluster > 1);
+    hpa->rows = file->rows;
+    hpa->cols = file->cols;
+    hpa->cluster = cluster;
+    hpa->cluster_rows = (file->rows + cluster - 1) / cluster;
+    hpa->cluster_cols = (file->cols + cluster - 1) / cluster;
+    hpa->mem_map = NULL;
+    hpa->mem_size = 0;
+    clusters = hpa->cluster_rows * hpa->cluster_cols;
+    hpa->cluster_offsets = malloc((clusters + 1) * sizeof(int));
+    hpa->xs = malloc(capacity * sizeof(int));
+    hpa->ys = malloc(capacity * sizeof(int));
+    assert(hpa->cluster_offsets != NULL && hpa->xs != NULL && hpa->ys != NULL);
+
+    /* collect entrances, cluster by cluster, walking only border cells. */
+    hpa->entrance_num = 0;
+    for (c = 0; c < clusters; c++) {
+        hpa->cluster_offsets[c] = hpa->entrance_num;
+        hpa_add_side(hpa, file, c, 1, 0, &capacity);
+        hpa_add_side(hpa, file, c, -1, 0, &capacity);
+        hpa_add_side(hpa, file, c, 0, 1, &capacity);
+        hpa_add_side(hpa, file, c, 0, -1, &capacity);
+    }
+    hpa->cluster_offsets[clusters] = hpa->entrance_num;
+
+    /* reserve room for the most edges each entrance can have. */
+    bound_offsets = malloc((hpa->entrance_num + 1) * sizeof(int));
+    degrees = calloc((size_t) hpa->entrance_num + 1, sizeof(int));
+    assert(bound_offsets != NULL && degrees != NULL);
+    bound_offsets[0] = 0;
+    for (c = 0; c < clusters; c++) {
+        int in_cluster = hpa->cluster_offsets[c + 1] - hpa->cluster_offsets[c];
+        for (e = hpa->cluster_offsets[c]; e < hpa->cluster_offsets[c + 1]; e++)
+            bound_offsets[e + 1] = bound_offsets[e] + in_cluster - 1 + 4;
+    }
+    hpa->offsets = bound_offsets;
+    hpa->targets = malloc((bound_offsets[hpa->entrance_num] + 1) * sizeof(int));
+    hpa->weights = malloc((bound_offsets[hpa->entrance_num] + 1) * sizeof(int));
+    assert(hpa->targets != NULL && hpa->weights != NULL);
+
+    /* fill edges, one cluster at a time per thread. */
+    thread_num = thread_num == 0 ? 1 : thread_num;
+    threads = malloc(thread_num * sizeof(pthread_t));
+    workers = malloc(thread_num * sizeof(hpa_worker_t));
+    assert(threads != NULL && workers != NULL);
+    for (t = 0; t < thread_num; t++) {
+        workers[t].hpa = hpa;
+        workers[t].file = file;
+        workers[t].next_cluster = &next_cluster;
+        workers[t].degrees = degrees;
+        if (pthread_create(threads + t, NULL, (void *(*)(void *)) hpa_build_worker, workers + t) != 0)
+            break;
+    }
+    /* clusters are handed out on demand, so fewer threads only take longer;
+     * with none at all, build here. */
+    if (t == 0) hpa_build_worker(workers);
+    thread_num = t;
+    for (t = 0; t < thread_num; t++)
+        pthread_join(threads[t], NULL);
+    free(threads);
+    free(workers);
+
+    /* compact edges. */
+    hpa->offsets = malloc((hpa->entrance_num + 1) * sizeof(int));
+    assert(hpa->offsets != NULL);
+    hpa->offsets[0] = 0;
+    for (e = 0; e < hpa->entrance_num; e++) {
+        for (i = 0; i < degrees[e]; i++) {
+            hpa->targets[hpa->offsets[e] + i] = hpa->targets[bound_offsets[e] + i];
+            hpa->weights[hpa->offsets[e] + i] = hpa->weights[bound_offsets[e] + i];
+        }
+        hpa->offsets[e + 1] = hpa->offsets[e] + degrees[e];
+    }
+    hpa->edge_num = hpa->offsets[hpa->entrance_num];
+    free(bound_offsets);
+    free(degrees);
+    return hpa;
+}
+
+/**
+ * Map the index saved in FILENAME. Returns NULL if there is no such file or
+ *   it was not saved for clusters of side CLUSTER on FILE as it is now. The
+ *   arrays are only checked where a query reads them, see hpa_search.
+ */
+hpa_t *hpa_load(const char *filename, const maze_file_t *file, int cluster) {
+    int fd = open(filename, O_RDONLY), key[5], *header, i;
+    struct stat status;
+    hpa_t *hpa;
+    void *mem_map;
+    size_t clusters, n, m, size;
+    if (fd == -1) return NULL;
+    if (fstat(fd, &status) == -1 || (size_t) status.st_size < HPA_HEADER * sizeof(int) ||
+        hpa_key(file, key) != 0) {
+        close(fd);
+        return NULL;
+    }
+    mem_map = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem_map == MAP_FAILED) return NULL;
+    header = mem_map;
+    clusters = (size_t) ((file->rows + cluster - 1) / cluster) * ((file->cols + cluster - 1) / cluster);
+    if (header[0] != HPA_MAGIC || header[1] != file->rows || header[2] != file->cols ||
+        header[3] != cluster || header[4] < 0 || (size_t) header[4] > (size_t) file->rows * file->cols ||
+        header[5] < 0 || (size_t) header[5] > (size_t) header[4] * (4 * (size_t) cluster + 4)) {
+        munmap(mem_map, (size_t) status.st_size);
+        return NULL;
+    }
+    for (i = 0; i < 5; i++) {
+        if (header[6 + i] != key[i]) {
+            munmap(mem_map, (size_t) status.st_size);
+            return NULL;
+        }
+    }
+    n = (size_t) header[4];
+    m = (size_t) header[5];
+    size = (HPA_HEADER + 3 * n + clusters + 2 + 2 * m) * sizeof(int);
+    if (size != (size_t) status.st_size) {
+        munmap(mem_map, (size_t) status.st_size);
+        return NULL;
+    }
+    hpa = malloc(sizeof(hpa_t));
+    assert(hpa != NULL);
+    hpa->rows = file->rows;
+    hpa->cols = file->cols;
+    hpa->cluster = cluster;
+    hpa->cluster_rows = (file->rows + cluster - 1) / cluster;
+    hpa->cluster_cols = (file->cols + cluster - 1) / cluster;
+    hpa->entrance_num = header[4];
+    hpa->edge_num = header[5];
+    hpa->xs = header + HPA_HEADER;
+    hpa->ys = hpa->xs + n;
+    hpa->cluster_offsets = hpa->ys + n;
+    hpa->offsets = hpa->cluster_offsets + clusters + 1;
+    hpa->targets = hpa->offsets + n + 1;
+    hpa->weights = hpa->targets + m;
+    hpa->mem_map = mem_map;
+    hpa->mem_size = size;
+    return hpa;
+}
+
+/**
+ * Save index HPA of maze FILE to FILENAME, keyed on the size and the
+ *   modification time of FILE. Returns 0 on success, -1 otherwise.
+ */
+int hpa_save(const hpa_t *hpa, const maze_file_t *file, const char *filename) {
+    FILE *out;
+    size_t clusters = (size_t) hpa->cluster_rows * hpa->cluster_cols;
+    size_t n = (size_t) hpa->entrance_num, m = (size_t) hpa->edge_num;
+    int header[HPA_HEADER];
+    int ok;
+    if (hpa_key(file, header + 6) != 0 || (out = fopen(filename, "wb")) == NULL) return -1;
+    header[0] = HPA_MAGIC;
+    header[1] = hpa->rows;
+    header[2] = hpa->cols;
+    header[3] = hpa->cluster;
+    header[4] = hpa->entrance_num;
+    header[5] = hpa->edge_num;
+    ok = fwrite(header, sizeof(int), HPA_HEADER, out) == HPA_HEADER &&
+         fwrite(hpa->xs, sizeof(int), n, out) == n &&
+         fwrite(hpa->ys, sizeof(int), n, out) == n &&
+         fwrite(hpa->cluster_offsets, sizeof(int), clusters + 1, out) == clusters + 1 &&
+         fwrite(hpa->offsets, sizeof(int), n + 1, out) == n + 1 &&
+         fwrite(hpa->targets, sizeof(int), m, out) == m &&
+         fwrite(hpa->weights, sizeof(int), m, out) == m;
+    if (fclose(out) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+/**
+ * Rekey the index saved in FILENAME to the current size and modification
+ *   time of FILE, after FILE was rewritten with its walls untouched, as when
+ *   a path is marked on it. Returns 0 on success, -1 otherwise.
+ */
+int hpa_rekey(const maze_file_t *file, const char *filename) {
+    FILE *out;
+    int key[5], magic, ok;
+    if (hpa_key(file, key) != 0 || (out = fopen(filename, "r+b")) == NULL) return -1;
+    ok = fread(&magic, sizeof(int), 1, out) == 1 && magic == HPA_MAGIC &&
+         fseek(out, 6 * (long) sizeof(int), SEEK_SET) == 0 &&
+         fwrite(key, sizeof(int), 5, out) == 5;
+    if (fclose(out) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+/**
+ * Whether entrance E of HPA lies on the maze, and in cluster C unless C is
+ *   negative. A mapped index is trusted no further than this.
+ */
+static int hpa_inside(const hpa_t *hpa, int e, int c) {
+    int x = hpa->xs[e], y = hpa->ys[e];
+    if (x < 0 || x >= hpa->cols || y < 0 || y >= hpa->rows) return 0;
+    return c < 0 || hpa_cluster_of(hpa, x, y) == c;
+}
+
+/**
+ * Index of cell (X, Y) in the corridor distances of hpa_refine, where SLOTS
+ *   holds the slot plus one of each cluster of the corridor. Returns -1 for
+ *   cells outside the corridor.
+ */
+static int hpa_corridor(const hpa_t *hpa, const int *slots, int x, int y) {
+    int c = hpa_cluster_of(hpa, x, y), x0, y0, w, h;
+    if (slots[c] == 0) return -1;
+    hpa_bounds(hpa, c, &x0, &y0, &w, &h);
+    return (slots[c] - 1) * hpa->cluster * hpa->cluster + (y - y0) * w + x - x0;
+}
+
+/**
+ * Refine the abstract path ending in PATH_END, from (START_X, START_Y) to
+ *   (GOAL_X, GOAL_Y), into PATH: a BFS over the cells of the clusters that
+ *   path crosses, so the result is the exact shortest path through them.
+ *   Returns the number of cells, -1 if those clusters do not connect.
+ */
+static int hpa_refine(const hpa_t *hpa, const maze_file_t *file, const node_t *path_end,
+                      int start_x, int start_y, int goal_x, int goal_y, path_t *path) {
+    size_t size = (size_t) hpa->cluster * hpa->cluster, cells, head = 0, tail = 0, i;
+    /* untouched pages are never faulted in, as for the abstract nodes. */
+    int *slots = calloc((size_t) hpa->cluster_rows * hpa->cluster_cols, sizeof(int));
+    int *dist, *queue_x, *queue_y;
+    int slot_num = 0, len = -1, x, y, d;
+    const node_t *node;
+    assert(slots != NULL);
+    for (node = path_end; node != NULL; node = node->parent) {
+        int c = hpa_cluster_of(hpa, node->x, node->y);
+        if (slots[c] == 0) slots[c] = ++slot_num;
+    }
+    cells = (size_t) slot_num * size;
+    dist = malloc(cells * sizeof(int));
+    queue_x = malloc(cells * sizeof(int));
+    queue_y = malloc(cells * sizeof(int));
+    assert(dist != NULL && queue_x != NULL && queue_y != NULL);
+    for (i = 0; i < cells; i++)
+        dist[i] = -1;
+
+    dist[hpa_corridor(hpa, slots, start_x, start_y)] = 0;
+    queue_x[tail] = start_x;
+    queue_y[tail++] = start_y;
+    while (head < tail && dist[hpa_corridor(hpa, slots, goal_x, goal_y)] < 0) {
+        int x_axis[4], y_axis[4], k;
+        x = queue_x[head];
+        y = queue_y[head++];
+        d = dist[hpa_corridor(hpa, slots, x, y)];
+        x_axis[0] = x + 1;
+        y_axis[0] = y;
+        x_axis[1] = x - 1;
+        y_axis[1] = y;
+        x_axis[2] = x;
+        y_axis[2] = y + 1;
+        x_axis[3] = x;
+        y_axis[3] = y - 1;
+        for (k = 0; k < 4; k++) {
+            int to;
+            if (x_axis[k] < 0 || x_axis[k] >= hpa->cols || y_axis[k] < 0 || y_axis[k] >= hpa->rows ||
+                maze_lines(file, x_axis[k], y_axis[k]) == '#')
+                continue;
+            to = hpa_corridor(hpa, slots, x_axis[k], y_axis[k]);
+            if (to < 0 || dist[to] != -1) continue;
+            dist[to] = d + 1;
+            queue_x[tail] = x_axis[k];
+            queue_y[tail++] = y_axis[k];
+        }
+    }
+
+    if (dist[hpa_corridor(hpa, slots, goal_x, goal_y)] >= 0) {
+        /* walk down the distances from the goal back to start. */
+        x = goal_x;
+        y = goal_y;
+        path_push(path, x, y);
+        for (d = dist[hpa_corridor(hpa, slots, x, y)]; d > 0; d--) {
+            int to;
+            if ((to = hpa_corridor(hpa, slots, x + 1, y)) >= 0 && dist[to] == d - 1) x++;
+            else if ((to = hpa_corridor(hpa, slots, x - 1, y)) >= 0 && dist[to] == d - 1) x--;
+            else if ((to = hpa_corridor(hpa, slots, x, y + 1)) >= 0 && dist[to] == d - 1) y++;
+            else y--;
+            path_push(path, x, y);
+        }
+        path_reverse(path);
+        len = path->len;
+    }
+    free(slots);
+    free(dist);
+    free(queue_x);
+    free(queue_y);
+    return len;
+}
+
+/**
+ * Relax the abstract node ID (at (X, Y)) to g-score GS through PARENT.
+ */
+static void hpa_relax(heap_t *heap, node_t *nodes, unsigned char *seen, node_t *parent, int id,
+                      int x, int y, int gs, const node_t *goal) {
+    node_t *node = &nodes[id];
+    if (!seen[id]) {
+        seen[id] = 1;
+        node_init(node, x, y);
+    }
+    if (gs < node->gs) {
+        node->parent = parent;
+        node->gs = gs;
+        node->fs = gs + abs(x - goal->x) + abs(y - goal->y);
+        if (node->heap_id != 0) heap_update(heap, node);
+        else heap_insert(heap, node);
+    }
+}
+
+/**
+ * Search a path from (START_X, START_Y) to (GOAL_X, GOAL_Y) on the abstract
+ *   graph HPA, then refine it through the clusters it crosses into PATH.
+ *   Returns the number of cells on the path, -1 if there is none, and
+ *   HPA_DAMAGED if the parts of the index it read do not hold together.
+ */
+int hpa_search(const hpa_t *hpa, const maze_file_t *file, int start_x, int start_y,
+               int goal_x, int goal_y, path_t *path) {
+    int n = hpa->entrance_num, start = n, goal = n + 1;
+    int start_c = hpa_cluster_of(hpa, start_x, start_y);
+    int goal_c = hpa_cluster_of(hpa, goal_x, goal_y);
+    int size = hpa->cluster * hpa->cluster;
+    int *start_dist = malloc(size * sizeof(int));
+    int *goal_dist = malloc(size * sizeof(int));
+    int *queue = malloc(size * sizeof(int));
+    /* untouched pages of these are never faulted in, so a query only pays
+     * for the abstract nodes it reaches. */
+    node_t *nodes = malloc((n + 2) * sizeof(node_t));
+    unsigned char *seen = calloc((size_t) n + 2, 1);
+    node_t *node, *path_end = NULL;
+    heap_t heap;
+    int len = HPA_DAMAGED;
+    assert(start_dist != NULL && goal_dist != NULL && queue != NULL && nodes != NULL && seen != NULL);
+
+    hpa_cluster_bfs(hpa, file, start_c, start_x, start_y, start_dist, queue);
+    hpa_cluster_bfs(hpa, file, goal_c, goal_x, goal_y, goal_dist, queue);
+    heap_init(&heap);
+    seen[goal] = 1;
+    node_init(&nodes[goal], goal_x, goal_y);
+    hpa_relax(&heap, nodes, seen, NULL, start, start_x, start_y, 0, &nodes[goal]);
+
+    while (heap.size > 1) {
+        int id, x0, y0, w, h, e, first, last;
+        node = heap_extract(&heap);
+        id = (int) (node - nodes);
+        if (id == goal) {
+            path_end = node;
+            break;
+        }
+        if (id == start) {
+            /* start connects to the entrances of its cluster. */
+            hpa_bounds(hpa, start_c, &x0, &y0, &w, &h);
+            first = hpa->cluster_offsets[start_c];
+            last = hpa->cluster_offsets[start_c + 1];
+            if (first < 0 || first > last || last > n) goto hpa_search_end;
+            for (e = first; e < last; e++) {
+                int d;
+                if (!hpa_inside(hpa, e, start_c)) goto hpa_search_end;
+                d = start_dist[(hpa->ys[e] - y0) * w + hpa->xs[e] - x0];
+                if (d >= 0) hpa_relax(&heap, nodes, seen, node, e, hpa->xs[e], hpa->ys[e], d, &nodes[goal]);
+            }
+            if (start_c == goal_c && start_dist[(goal_y - y0) * w + goal_x - x0] >= 0)
+                hpa_relax(&heap, nodes, seen, node, goal, goal_x, goal_y,
+                          start_dist[(goal_y - y0) * w + goal_x - x0], &nodes[goal]);
+        } else {
+            first = hpa->offsets[id];
+            last = hpa->offsets[id + 1];
+            if (first < 0 || first > last || last > hpa->edge_num) goto hpa_search_end;
+            for (e = first; e < last; e++) {
+                int to = hpa->targets[e];
+                if (to < 0 || to >= n || hpa->weights[e] <= 0 || !hpa_inside(hpa, to, -1))
+                    goto hpa_search_end;
+                hpa_relax(&heap, nodes, seen, node, to, hpa->xs[to], hpa->ys[to],
+                          node->gs + hpa->weights[e], &nodes[goal]);
+            }
+            /* the entrances of the goal cluster connect to the goal. */
+            if (hpa_cluster_of(hpa, node->x, node->y) == goal_c) {
+                int d;
+                hpa_bounds(hpa, goal_c, &x0, &y0, &w, &h);
+                d = goal_dist[(node->y - y0) * w + node->x - x0];
+                if (d >= 0)
+                    hpa_relax(&heap, nodes, seen, node, goal, goal_x, goal_y, node->gs + d, &nodes[goal]);
+            }
+        }
+    }
+
+    if (path_end == NULL) {
+        len = -1;
+    } else {
+        len = hpa_refine(hpa, file, path_end, start_x, start_y, goal_x, goal_y, path);
+        /* the abstract path is made of real steps, so only a bad index
+         * leaves its clusters unconnected. */
+        if (len < 0) len = HPA_DAMAGED;
+    }
+
+    hpa_search_end:
+    heap_destroy(&heap);
+    free(start_dist);
+    free(goal_dist);
+    free(queue);
+    free(nodes);
+    free(seen);
+    return len;
+}
+
+/**
+ * Delete the memory occupied by the index HPA.
+ */
+void hpa_destroy(hpa_t *hpa) {
+    if (hpa->mem_map != NULL) {
+        munmap(hpa->mem_map, hpa->mem_size);
+    } else {
+        free(hpa->xs);
+        free(hpa->ys);
+        free(hpa->cluster_offsets);
+        free(hpa->offsets);
+        free(hpa->targets);
+        free(hpa->weights);
+    }
+    free(hpa);
+}
@@ -0,0 +1,71 @@
+/**
+ * File: hpa.h
+ *
+ *   Declaration of the hierarchical abstraction (HPA*-style) index. The maze
+ *     is cut into square clusters. Each run of open cell pairs across a
+ *     cluster border gets one transition at its middle, or two at its ends
+ *     when longer than HPA_RUN_SPLIT, and the cells of a transition are
+ *     entrances. Entrances are linked by intra-cluster shortest distances and
+ *     by unit inter-cluster steps, so the index grows with the shape of the
+ *     borders rather than with the cluster size. A query refines the
+ *     abstract path into the exact shortest path through the clusters it
+ *     crosses.
+ *
+ *     File: int[11] header { HPA_MAGIC, rows, cols, cluster, entrances,
+ *     edges, maze size lo, hi, maze mtime lo, hi, mtime ns }, then xs, ys,
+ *     cluster offsets, offsets, targets and weights. It is mapped, not read,
+ *     so a query only faults in the part of the index it visits.
+ */
+
+#ifndef _HPA_H_
+#define _HPA_H_
+
+#include <stddef.h>     /* size_t */
+#include "maze.h"
+#include "path.h"
+
+#define HPA_MAGIC               (0x41504448)    /* "HDPA" */
+#define HPA_RUN_SPLIT           (6)
+#define HPA_DAMAGED             (-2)            /* hpa_search on a bad index. */
+
+#define hpa_cluster_of(hpa, x, y) \
+    (((y) / (hpa)->cluster) * (hpa)->cluster_cols + (x) / (hpa)->cluster)
+
+
+/**
+ * Structure of the abstract graph. Entrances are grouped by cluster, and
+ *   edges are kept in compressed sparse rows.
+ */
+typedef struct hpa_t {
+    int rows;               /* Number of rows of the maze. */
+    int cols;               /* Number of cols of the maze. */
+    int cluster;            /* Side length of a cluster. */
+    int cluster_rows;       /* Number of cluster rows. */
+    int cluster_cols;       /* Number of cluster cols. */
+    int entrance_num;       /* Number of entrances. */
+    int edge_num;           /* Number of directed edges. */
+    int *xs;                /* X coordinates of entrances. */
+    int *ys;                /* Y coordinates of entrances. */
+    int *cluster_offsets;   /* Entrances of cluster C are [C], [C + 1]). */
+    int *offsets;           /* Edges of entrance E are [E], [E + 1]). */
+    int *targets;           /* Target entrance of each edge. */
+    int *weights;           /* Length of each edge. */
+    void *mem_map;          /* Mapped index file, NULL if built. */
+    size_t mem_size;        /* Mapped size. */
+} hpa_t;
+
+/* Function prototypes. */
+hpa_t *hpa_init(const maze_file_t *file, int cluster, size_t thread_num);
+
+hpa_t *hpa_load(const char *filename, const maze_file_t *file, int cluster);
+
+int hpa_save(const hpa_t *hpa, const maze_file_t *file, const char *filename);
+
+int hpa_rekey(const maze_file_t *file, const char *filename);
+
+int hpa_search(const hpa_t *hpa, const maze_file_t *file, int start_x, int start_y,
+               int goal_x, int goal_y, path_t *path);
+
+void hpa_destroy(hpa_t *hpa);
+
+#endif
@@ -0,0 +1,318 @@
+/**
+ * File: landmark.c
+ *
+ *   Implementation of the landmark (ALT) distance fields. Each field is
+ *     filled by a level-synchronous BFS shared by a group of threads, the
+ *     narrow levels (corridors) being walked by a single thread so that the
+ *     barriers are only paid where the frontier is wide enough to split.
+ */
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdio.h>      /* FILE, fopen, fread, fwrite */
+#include <stdlib.h>     /* malloc, free, exit */
+#include <string.h>     /* memcpy */
+#include <assert.h>     /* assert */
+#include <pthread.h>
+#include "landmark.h"
+
+/* Frontier narrower than this is expanded by a single thread. */
+#define LANDMARK_PARALLEL_MIN   (0x1000)
+/* Size of per-thread buffer of newly discovered cells. */
+#define LANDMARK_BATCH          (0x400)
+
+typedef struct landmark_bfs_t {
+    const maze_file_t *file;
+    unsigned int *dists;            /* Field being filled, with stride. */
+    size_t stride;
+    size_t *frontier;               /* Cells at distance LEVEL. */
+    size_t *next;                   /* Cells at distance LEVEL + 1. */
+    size_t frontier_len;
+    size_t next_len;
+    unsigned int level;
+    size_t thread_num;
+    pthread_barrier_t barrier;
+} landmark_bfs_t;
+
+typedef struct landmark_worker_t {
+    landmark_bfs_t *bfs;
+    size_t thread_id;
+} landmark_worker_t;
+
+/**
+ * Append the LEN buffered cells in LOCAL to the next frontier of BFS.
+ */
+static void landmark_bfs_flush(landmark_bfs_t *bfs, size_t *local, size_t *len) {
+    size_t pos = __atomic_fetch_add(&bfs->next_len, *len, __ATOMIC_RELAXED);
+    memcpy(bfs->next + pos, local, *len * sizeof(size_t));
+    *len = 0;
+}
+
+/**
+ * Expand frontier cells in [BEGIN, END), claiming unvisited neighbours.
+ */
+static void landmark_bfs_expand(landmark_bfs_t *bfs, size_t begin, size_t end, size_t *local) {
+    size_t cols = (size_t) bfs->file->cols;
+    unsigned int level = bfs->level + 1;
+    size_t len = 0, i, j;
+    for (i = begin; i < end; i++) {
+        size_t cell = bfs->frontier[i];
+        size_t adj[4];
+        adj[0] = cell + 1;
+        adj[1] = cell - 1;
+        adj[2] = cell + cols;
+        adj[3] = cell - cols;
+        for (j = 0; j < 4; j++) {
+            unsigned int expected = LANDMARK_UNREACHABLE;
+            int ax = (int) (adj[j] % cols), ay = (int) (adj[j] / cols);
+            if (maze_lines(bfs->file, ax, ay) == '#') continue;
+            if (__atomic_compare_exchange_n(&bfs->dists[adj[j] * bfs->stride], &expected, level,
+                                            0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                local[len++] = adj[j];
+                if (len == LANDMARK_BATCH) landmark_bfs_flush(bfs, local, &len);
+            }
+        }
+    }
+    if (len != 0) landmark_bfs_flush(bfs, local, &len);
+}
+
+/**
+ * Finish one BFS level: the next frontier becomes the current one.
+ */
+static void landmark_bfs_advance(landmark_bfs_t *bfs) {
+    size_t *tmp = bfs->frontier;
+    bfs->frontier = bfs->next;
+    bfs->next = tmp;
+    bfs->frontier_len = bfs->next_len;
+    bfs->next_len = 0;
+    bfs->level++;
+}
+
+static void *landmark_bfs_worker(landmark_worker_t *worker) {
+    landmark_bfs_t *bfs = worker->bfs;
+    size_t *local = malloc(LANDMARK_BATCH * sizeof(size_t));
+    assert(local != NULL);
+    while (bfs->frontier_len != 0) {
+        if (bfs->frontier_len < LANDMARK_PARALLEL_MIN) {
+            /* narrow frontier, walk it alone until it widens, once everyone
+             * has seen the current length. */
+            pthread_barrier_wait(&bfs->barrier);
+            if (worker->thread_id == 0) {
+                while (bfs->frontier_len != 0 && bfs->frontier_len < LANDMARK_PARALLEL_MIN) {
+                    landmark_bfs_expand(bfs, 0, bfs->frontier_len, local);
+                    landmark_bfs_advance(bfs);
+                }
+            }
+            pthread_barrier_wait(&bfs->barrier);
+        } else {
+            size_t begin = bfs->frontier_len * worker->thread_id / bfs->thread_num;
+            size_t end = bfs->frontier_len * (worker->thread_id + 1) / bfs->thread_num;
+            landmark_bfs_expand(bfs, begin, end, local);
+            if (pthread_barrier_wait(&bfs->barrier) == PTHREAD_BARRIER_SERIAL_THREAD)
+                landmark_bfs_advance(bfs);
+            pthread_barrier_wait(&bfs->barrier);
+        }
+    }
+    free(local);
+    return NULL;
+}
+
+/**
+ * Fill DISTS (with STRIDE between cells) by BFS from (X, Y), using BFS's
+ *   frontier buffers and THREAD_NUM threads.
+ */
+static void landmark_bfs(landmark_bfs_t *bfs, unsigned int *dists, size_t stride, int x, int y) {
+    pthread_t *threads = malloc(bfs->thread_num * sizeof(pthread_t));
+    landmark_worker_t *workers = malloc(bfs->thread_num * sizeof(landmark_worker_t));
+    size_t area = (size_t) bfs->file->rows * bfs->file->cols;
+    size_t start = (size_t) y * bfs->file->cols + x;
+    size_t i;
+    for (i = 0; i < area; i++)
+        dists[i * stride] = LANDMARK_UNREACHABLE;
+    dists[start * stride] = 0;
+    bfs->dists = dists;
+    bfs->stride = stride;
+    bfs->frontier[0] = start;
+    bfs->frontier_len = 1;
+    bfs->next_len = 0;
+    bfs->level = 0;
+    assert(threads != NULL && workers != NULL);
+    /* every worker waits on the barrier, so all of them must start. */
+    if (pthread_barrier_init(&bfs->barrier, NULL, (unsigned int) bfs->thread_num) != 0) {
+        fprintf(stderr, "cannot set up landmark threads\n");
+        exit(1);
+    }
+    for (i = 0; i < bfs->thread_num; i++) {
+        workers[i].bfs = bfs;
+        workers[i].thread_id = i;
+        if (pthread_create(threads + i, NULL, (void *(*)(void *)) landmark_bfs_worker, workers + i) != 0) {
+            fprintf(stderr, "cannot create landmark thread\n");
+            exit(1);
+        }
+    }
+    for (i = 0; i < bfs->thread_num; i++)
+        pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&bfs->barrier);
+    free(threads);
+    free(workers);
+}
+
+/**
+ * Entrances are marked as walls by maze_file_init, but they are the search
+ *   goals, so give them the distance through their only open neighbour.
+ */
+static void landmark_fix_entrances(const maze_file_t *file, unsigned int *dists, size_t stride) {
+    size_t cols = (size_t) file->cols;
+    size_t in = cols, out = (size_t) (file->rows - 2) * cols + cols - 1;
+    if (dists[(in + 1) * stride] != LANDMARK_UNREACHABLE)
+        dists[in * stride] = dists[(in + 1) * stride] + 1;
+    if (dists[(out - 1) * stride] != LANDMARK_UNREACHABLE)
+        dists[out * stride] = dists[(out - 1) * stride] + 1;
+}
+
+/**
+ * Choose COUNT landmarks on the maze FILE by farthest-point selection seeded
+ *   at (START_X, START_Y), and compute their exact distance fields using
+ *   THREAD_NUM threads. Returns the pointer to the new landmarks.
+ */
+landmark_t *landmark_init(const maze_file_t *file, int count, int start_x, int start_y,
+                          size_t thread_num) {
+    landmark_t *lm = malloc(sizeof(landmark_t));
+    size_t area = (size_t) file->rows * file->cols;
+    unsigned int *nearest = malloc(area * sizeof(unsigned int));
+    landmark_bfs_t bfs;
+    size_t i;
+    int k;
+    assert(lm != NULL && nearest != NULL);
+    assert(count > 0 && count <= LANDMARK_MAX);
+    lm->count = count;
+    lm->rows = file->rows;
+    lm->cols = file->cols;
+    lm->dists = malloc(area * count * sizeof(unsigned int));
+    assert(lm->dists != NULL);
+    bfs.file = file;
+    bfs.thread_num = thread_num == 0 ? 1 : thread_num;
+    bfs.frontier = malloc(area * sizeof(size_t));
+    bfs.next = malloc(area * sizeof(size_t));
+    assert(bfs.frontier != NULL && bfs.next != NULL);
+
+    /* NEAREST holds the distance to the closest chosen landmark (or start). */
+    landmark_bfs(&bfs, nearest, 1, start_x, start_y);
+    for (k = 0; k < count; k++) {
+        size_t best = (size_t) start_y * file->cols + start_x;
+        unsigned int best_dist = 0;
+        for (i = 0; i < area; i++) {
+            if (nearest[i] != LANDMARK_UNREACHABLE && nearest[i] > best_dist) {
+                best_dist = nearest[i];
+                best = i;
+            }
+        }
+        lm->xs[k] = (int) (best % file->cols);
+        lm->ys[k] = (int) (best / file->cols);
+        landmark_bfs(&bfs, lm->dists + k, (size_t) count, lm->xs[k], lm->ys[k]);
+        for (i = 0; i < area; i++)
+            if (lm->dists[i * count + k] < nearest[i])
+                nearest[i] = lm->dists[i * count + k];
+        landmark_fix_entrances(file, lm->dists + k, (size_t) count);
+    }
+
+    free(bfs.frontier);
+    free(bfs.next);
+    free(nearest);
+    return lm;
+}
+
+/**
+ * Load landmarks saved in FILENAME. Returns NULL if there is no such file or
+ *   it does not describe COUNT landmarks on the very cells of FILE.
+ */
+landmark_t *landmark_load(const char *filename, const maze_file_t *file, int count) {
+    FILE *in = fopen(filename, "rb");
+    landmark_t *lm = NULL;
+    unsigned long hash = maze_file_hash(file);
+    int header[6], k;
+    size_t size;
+    if (in == NULL) return NULL;
+    if (fread(header, sizeof(int), 6, in) != 6 || header[0] != LANDMARK_MAGIC ||
+        header[1] != count || header[2] != file->rows || header[3] != file->cols ||
+        (unsigned int) header[4] != (unsigned int) (hash & 0xffffffffUL) ||
+        (unsigned int) header[5] != (unsigned int) (hash >> 32)) {
+        fclose(in);
+        return NULL;
+    }
+    lm = malloc(sizeof(landmark_t));
+    assert(lm != NULL);
+    lm->count = count;
+    lm->rows = file->rows;
+    lm->cols = file->cols;
+    size = (size_t) lm->rows * lm->cols * count;
+    lm->dists = malloc(size * sizeof(unsigned int));
+    assert(lm->dists != NULL);
+    if (fread(lm->xs, sizeof(int), (size_t) count, in) != (size_t) count ||
+        fread(lm->ys, sizeof(int), (size_t) count, in) != (size_t) count ||
+        fread(lm->dists, sizeof(unsigned int), size, in) != size) {
+        landmark_destroy(lm);
+        lm = NULL;
+    }
+    for (k = 0; lm != NULL && k < count; k++) {
+        if (lm->xs[k] < 0 || lm->xs[k] >= lm->cols || lm->ys[k] < 0 || lm->ys[k] >= lm->rows) {
+            landmark_destroy(lm);
+            lm = NULL;
+        }
+    }
+    fclose(in);
+    return lm;
+}
+
+/**
+ * Save landmarks LM of maze FILE to FILENAME, keyed on the hash of FILE.
+ *   Returns 0 on success, -1 otherwise.
+ */
+int landmark_save(const landmark_t *lm, const maze_file_t *file, const char *filename) {
+    FILE *out = fopen(filename, "wb");
+    size_t size = (size_t) lm->rows * lm->cols * lm->count;
+    unsigned long hash = maze_file_hash(file);
+    int header[6];
+    int ok;
+    if (out == NULL) return -1;
+    header[0] = LANDMARK_MAGIC;
+    header[1] = lm->count;
+    header[2] = lm->rows;
+    header[3] = lm->cols;
+    header[4] = (int) (hash & 0xffffffffUL);
+    header[5] = (int) (hash >> 32);
+    ok = fwrite(header, sizeof(int), 6, out) == 6 &&
+         fwrite(lm->xs, sizeof(int), (size_t) lm->count, out) == (size_t) lm->count &&
+         fwrite(lm->ys, sizeof(int), (size_t) lm->count, out) == (size_t) lm->count &&
+         fwrite(lm->dists, sizeof(unsigned int), size, out) == size;
+    if (fclose(out) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+/**
+ * Triangle-inequality lower bound of the distance between (X1, Y1) and
+ *   (X2, Y2): max over landmarks L of |d(L, 1) - d(L, 2)|.
+ */
+int landmark_bound(const landmark_t *lm, int x1, int y1, int x2, int y2) {
+    const unsigned int *d1 = &landmark_dist(lm, 0, x1, y1);
+    const unsigned int *d2 = &landmark_dist(lm, 0, x2, y2);
+    int bound = 0, i;
+    for (i = 0; i < lm->count; i++) {
+        int diff;
+        if (d1[i] == LANDMARK_UNREACHABLE || d2[i] == LANDMARK_UNREACHABLE) continue;
+        diff = (int) d1[i] - (int) d2[i];
+        if (diff < 0) diff = -diff;
+        if (diff > bound) bound = diff;
+    }
+    return bound;
+}
+
+/**
+ * Delete the memory occupied by the landmarks LM.
+ */
+void landmark_destroy(landmark_t *lm) {
+    free(lm->dists);
+    free(lm);
+}
@@ -0,0 +1,50 @@
+/**
+ * File: landmark.h
+ *
+ *   Declaration of the landmark (ALT) distance fields. A handful of landmark
+ *     cells are chosen by farthest-point selection, and the exact distance
+ *     from each landmark to every cell is precomputed, so that the triangle
+ *     inequality gives an admissible lower bound between any two cells.
+ */
+
+#ifndef _LANDMARK_H_
+#define _LANDMARK_H_
+
+#include <stddef.h>     /* size_t */
+#include "maze.h"
+
+#define LANDMARK_MAGIC          (0x4c414448)    /* "HDAL" */
+#define LANDMARK_UNREACHABLE    (0xffffffffu)
+#define LANDMARK_MAX            (16)
+
+/* Distance from the I-th landmark of LM to cell (X, Y). */
+#define landmark_dist(lm, i, x, y) \
+    ((lm)->dists[((size_t) (y) * (lm)->cols + (x)) * (lm)->count + (i)])
+
+
+/**
+ * Structure of the landmark distance fields. Distances are stored cell-major,
+ *   so all the landmark distances of one cell share a cache line.
+ */
+typedef struct landmark_t {
+    int count;              /* Number of landmarks. */
+    int rows;               /* Number of rows. */
+    int cols;               /* Number of cols. */
+    int xs[LANDMARK_MAX];   /* X coordinates of landmarks. */
+    int ys[LANDMARK_MAX];   /* Y coordinates of landmarks. */
+    unsigned int *dists;    /* rows * cols * count exact distances. */
+} landmark_t;
+
+/* Function prototypes. */
+landmark_t *landmark_init(const maze_file_t *file, int count, int start_x, int start_y,
+                          size_t thread_num);
+
+landmark_t *landmark_load(const char *filename, const maze_file_t *file, int count);
+
+int landmark_save(const landmark_t *lm, const maze_file_t *file, const char *filename);
+
+int landmark_bound(const landmark_t *lm, int x1, int y1, int x2, int y2);
+
+void landmark_destroy(landmark_t *lm);
+
+#endif
@@ -0,0 +1,176 @@
+/**
+ * File: lpa.c
+ *
+ *   Implementation of the incremental (LPA*) planner on the 4-connected maze
+ *     with unit steps. Cells are ordered by k1 = min(g, rhs) + h only, which
+ *     keeps them on the ordinary node heap; with the consistent manhattan
+ *     heuristic this is enough, provided ties with the goal key are drained
+ *     before stopping.
+ */
+
+#include <stdlib.h>     /* abs, malloc, free */
+#include <limits.h>     /* INT_MAX */
+#include <assert.h>     /* assert */
+#include "lpa.h"
+
+#define LPA_INF     INT_MAX
+
+static int lpa_key(const lpa_t *lpa, const lpa_node_t *cell) {
+    int g = cell->node.gs < cell->rhs ? cell->node.gs : cell->rhs;
+    if (g == LPA_INF) return LPA_INF;
+    return g + abs(cell->node.x - lpa->goal_x) + abs(cell->node.y - lpa->goal_y);
+}
+
+/**
+ * Recompute rhs of cell (X, Y) and requeue it if it is inconsistent.
+ */
+static void lpa_update(lpa_t *lpa, int x, int y) {
+    lpa_node_t *cell = &lpa_node(lpa, x, y);
+    if (x != lpa->start_x || y != lpa->start_y) {
+        int rhs = LPA_INF;
+        if (maze_lines(lpa->file, x, y) != '#') {
+            int x_axis[4], y_axis[4], i;
+            x_axis[0] = x + 1;
+            y_axis[0] = y;
+            x_axis[1] = x - 1;
+            y_axis[1] = y;
+            x_axis[2] = x;
+            y_axis[2] = y + 1;
+            x_axis[3] = x;
+            y_axis[3] = y - 1;
+            for (i = 0; i < 4; i++) {
+                int gs = lpa_node(lpa, x_axis[i], y_axis[i]).node.gs;
+                if (maze_lines(lpa->file, x_axis[i], y_axis[i]) != '#' && gs != LPA_INF &&
+                    gs + 1 < rhs)
+                    rhs = gs + 1;
+            }
+        }
+        cell->rhs = rhs;
+    }
+    if (cell->node.heap_id != 0) heap_remove(&lpa->heap, &cell->node);
+    if (cell->node.gs != cell->rhs) {
+        cell->node.fs = lpa_key(lpa, cell);
+        heap_insert(&lpa->heap, &cell->node);
+    }
+}
+
+static void lpa_update_neighbours(lpa_t *lpa, int x, int y) {
+    lpa_update(lpa, x + 1, y);
+    lpa_update(lpa, x - 1, y);
+    lpa_update(lpa, x, y + 1);
+    lpa_update(lpa, x, y - 1);
+}
+
+/**
+ * Initialize a planner from (START_X, START_Y) to (GOAL_X, GOAL_Y) on maze
+ *   FILE. Returns the pointer to the new planner, nothing is searched yet.
+ */
+lpa_t *lpa_init(maze_file_t *file, int start_x, int start_y, int goal_x, int goal_y) {
+    lpa_t *lpa = malloc(sizeof(lpa_t));
+    size_t size = (size_t) file->rows * file->cols, i;
+    lpa_node_t *start;
+    assert(lpa != NULL);
+    lpa->file = file;
+    lpa->nodes = malloc(size * sizeof(lpa_node_t));
+    assert(lpa->nodes != NULL);
+    for (i = 0; i < size; i++) {
+        node_init(&lpa->nodes[i].node, (int) (i % file->cols), (int) (i / file->cols));
+        lpa->nodes[i].rhs = LPA_INF;
+    }
+    lpa->start_x = start_x;
+    lpa->start_y = start_y;
+    lpa->goal_x = goal_x;
+    lpa->goal_y = goal_y;
+    lpa->expanded = 0;
+    heap_init(&lpa->heap);
+    start = &lpa_node(lpa, start_x, start_y);
+    start->rhs = 0;
+    start->node.fs = lpa_key(lpa, start);
+    heap_insert(&lpa->heap, &start->node);
+    return lpa;
+}
+
+/**
+ * Toggle cell (X, Y) between wall and open. Returns 0 on success, -1 if the
+ *   cell is on the border or is the start or goal.
+ */
+int lpa_toggle(lpa_t *lpa, int x, int y) {
+    char *c;
+    if (x <= 0 || y <= 0 || x >= lpa->file->cols - 1 || y >= lpa->file->rows - 1 ||
+        (x == lpa->start_x && y == lpa->start_y) || (x == lpa->goal_x && y == lpa->goal_y))
+        return -1;
+    c = &maze_lines(lpa->file, x, y);
+    *c = *c == '#' ? ' ' : '#';
+    lpa_update(lpa, x, y);
+    lpa_update_neighbours(lpa, x, y);
+    return 0;
+}
+
+/**
+ * Expand inconsistent cells until the goal is consistent and no queued cell
+ *   can still change it. Returns the number of cells on the shortest path,
+ *   -1 if the goal is unreachable.
+ */
+int lpa_replan(lpa_t *lpa) {
+    lpa_node_t *goal = &lpa_node(lpa, lpa->goal_x, lpa->goal_y);
+    lpa->expanded = 0;
+    while (lpa->heap.size > 1 &&
+           (lpa->heap.nodes[1]->fs <= lpa_key(lpa, goal) || goal->rhs != goal->node.gs)) {
+        lpa_node_t *cell = (lpa_node_t *) heap_extract(&lpa->heap);
+        lpa->expanded++;
+        if (cell->node.gs > cell->rhs) {
+            /* overconsistent, settle it. */
+            cell->node.gs = cell->rhs;
+        } else {
+            /* underconsistent, forget it and let it be rebuilt. */
+            cell->node.gs = LPA_INF;
+            lpa_update(lpa, cell->node.x, cell->node.y);
+        }
+        lpa_update_neighbours(lpa, cell->node.x, cell->node.y);
+    }
+    return goal->node.gs == LPA_INF ? -1 : goal->node.gs + 1;
+}
+
+/**
+ * Append the current shortest path to PATH, moving from the goal to the
+ *   open neighbour with least g each step. Returns the number of cells
+ *   appended.
+ */
+int lpa_path(lpa_t *lpa, path_t *path) {
+    int x = lpa->goal_x, y = lpa->goal_y, len = 1;
+    if (lpa_node(lpa, x, y).node.gs == LPA_INF) return 0;
+    path_push(path, x, y);
+    while (x != lpa->start_x || y != lpa->start_y) {
+        int x_axis[4], y_axis[4], i, best = 0, best_gs = LPA_INF;
+        x_axis[0] = x + 1;
+        y_axis[0] = y;
+        x_axis[1] = x - 1;
+        y_axis[1] = y;
+        x_axis[2] = x;
+        y_axis[2] = y + 1;
+        x_axis[3] = x;
+        y_axis[3] = y - 1;
+        for (i = 0; i < 4; i++) {
+            int gs = lpa_node(lpa, x_axis[i], y_axis[i]).node.gs;
+            if (maze_lines(lpa->file, x_axis[i], y_axis[i]) != '#' && gs < best_gs) {
+                best = i;
+                best_gs = gs;
+            }
+        }
+        x = x_axis[best];
+        y = y_axis[best];
+        path_push(path, x, y);
+        len++;
+    }
+    path_reverse(path);
+    return len;
+}
+
+/**
+ * Delete the memory occupied by the planner LPA.
+ */
+void lpa_destroy(lpa_t *lpa) {
+    heap_destroy(&lpa->heap);
+    free(lpa->nodes);
+    free(lpa);
+}
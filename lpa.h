@@ -0,0 +1,53 @@
+/**
+ * File: lpa.h
+ *
+ *   Declaration of the incremental (LPA*) planner. It keeps g and rhs values
+ *     of every cell across maze edits, so that after a few cells toggle only
+ *     the locally inconsistent cells are expanded again to repair the
+ *     shortest path.
+ */
+
+#ifndef _LPA_H_
+#define _LPA_H_
+
+#include <stddef.h>     /* size_t */
+#include "heap.h"
+#include "maze.h"
+#include "node.h"
+#include "path.h"
+
+#define lpa_node(lpa, x, y)     ((lpa)->nodes[(size_t) (y) * (lpa)->file->cols + (x)])
+
+
+/**
+ * Structure of a cell of the incremental planner. NODE.gs is the g value and
+ *   NODE.fs the primary key while the cell is queued.
+ */
+typedef struct lpa_node_t {
+    node_t node;            /* Cell node, first so heap nodes cast back. */
+    int rhs;                /* One-step lookahead of g. */
+} lpa_node_t;
+
+typedef struct lpa_t {
+    maze_file_t *file;      /* Maze, whose walls are edited in place. */
+    lpa_node_t *nodes;      /* Array of all cells. */
+    heap_t heap;            /* Locally inconsistent cells. */
+    int start_x;
+    int start_y;
+    int goal_x;
+    int goal_y;
+    size_t expanded;        /* Expansions of the last replan. */
+} lpa_t;
+
+/* Function prototypes. */
+lpa_t *lpa_init(maze_file_t *file, int start_x, int start_y, int goal_x, int goal_y);
+
+int lpa_toggle(lpa_t *lpa, int x, int y);
+
+int lpa_replan(lpa_t *lpa);
+
+int lpa_path(lpa_t *lpa, path_t *path);
+
+void lpa_destroy(lpa_t *lpa);
+
+#endif
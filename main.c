@@ -36,43 +36,78 @@
 #define _DEFAULT_SOURCE
 #endif
 
-#include <stdlib.h>     /* NULL */
+#include <stdlib.h>     /* NULL, exit */
 #include <assert.h>     /* assert */
 #include <pthread.h>
 #include <limits.h>
+#include <stdio.h>      /* fprintf */
+#include <string.h>     /* strlen, strcpy, strcat, strcmp */
+#include <unistd.h>     /* getopt */
+#include <errno.h>      /* ETIMEDOUT */
+#include <time.h>       /* clock_gettime */
 #include <sys/mman.h>
+#include <sys/stat.h>     /* stat, fstat */
 #include <sys/sysinfo.h>
 #include <omp.h>
 
 #include "heap.h"
 #include "node.h"
 #include "maze.h"
+#include "landmark.h"
+#include "hpa.h"
+#include "lpa.h"
+#include "path.h"
+#include "serial.h"
+#include "trace.h"
 #include "compass.h"    /* The heuristic. */
 
 #define hash_distribute(num, x, y)      (((x) + (y)) % num)
 #define MSG_MEM_MAP_SIZE    (0X10000)
 
+/* Record an event of the running HDA* thread, if the search is traced. */
+#define hda_trace(args, event, x, y, gs, fs) do { \
+    if ((args)->trace != NULL) \
+        trace_record((args)->trace, trace_clock((args)->trace), event, x, y, gs, fs, \
+                     (args)->state->heap.size - 1); \
+} while (0)
+
+/* Heuristic weights are fixed point, WEIGHT_ONE being plain A*. */
+#define WEIGHT_ONE          (1000)
+#define ANYTIME_WEIGHT      (3 * WEIGHT_ONE)
+#define weighted_f(gs, h, weight)   ((gs) + (int) ((long) (h) * (weight) / WEIGHT_ONE))
+
+/* G-scores past this end a search as too long, so that two of them still add
+ * up to a bound without wrapping and the path still fits a path_t. */
+#define HDA_GS_MAX          (INT_MAX / 4)
+
+/* Path output formats, see path.h. */
+#define OUTPUT_MAZE         (0)
+#define OUTPUT_RLE          (1)
+#define OUTPUT_DIR          (2)
+
+/* Batch mode: mazes of this many cells or more get every thread. */
+#define BATCH_LARGE_AREA    (0x100000)
+#define BATCH_QUEUE_SIZE    (0x10)
+
+/* Mazes of this many cells or more keep sparse search state. */
+#define MAZE_SPARSE_AREA    (0x4000000)
+
+#define FIELD_MAGIC         (0x46444448)    /* "HDDF" */
+#define FIELD_UNREACHABLE   (0xffffffffu)
+
 typedef struct a_star_return_t {
     int x;
     int y;
     int min_len;
+    int overflow;           /* Set if the g-scores outgrew HDA_GS_MAX. */
 } a_star_return_t;
 
-typedef struct a_star_argument_t {
-    const maze_file_t *file;
-    const maze_t *other_maze;
-    maze_t *maze;
-    pthread_mutex_t *return_value_mutex;
-    a_star_return_t *return_value;
-    size_t thread_num;
-    size_t *finished;
-} a_star_argument_t;
-
 typedef struct hda_message_t {
     node_t *parent;
     int x;
     int y;
     int gs;
+    unsigned long stamp;    /* Send time, if the search is traced. */
     struct hda_message_t *next;
 } hda_message_t;
 
@@ -87,6 +122,32 @@ typedef struct hda_mq_t {
     void *padding_2[11];
 } hda_mq_t;
 
+/**
+ * Targets of a one-to-many search. Once all distinct open targets are
+ *   reached, the search is bounded by the farthest of them.
+ */
+typedef struct targets_t {
+    int num;                /* Number of targets as given. */
+    int capacity;
+    int *xs;                /* X coordinates. */
+    int *ys;                /* Y coordinates. */
+    int distinct;           /* Number of distinct open target cells. */
+    int reached;            /* Number of those reached so far. */
+    int *gs;                /* Best g-score of each distinct cell. */
+    int *index;             /* Distinct index of each cell, -1 if none. */
+} targets_t;
+
+/**
+ * Search state of one HDA* thread, kept across rounds of the same search.
+ */
+typedef struct hda_state_t {
+    mem_pool_t mem_pool;    /* Nodes owned by the thread. */
+    heap_t heap;            /* Open nodes. */
+    node_t **incons;        /* Nodes set aside by the bound, reopened next round. */
+    size_t incons_len;
+    size_t incons_cap;
+} hda_state_t;
+
 typedef struct hda_argument_t {
     const maze_file_t *file;
     const maze_t *other_maze;
@@ -97,9 +158,37 @@ typedef struct hda_argument_t {
     size_t thread_id;
     hda_mq_t *mqs;
     size_t *msg_sent, *msg_received;
+    const size_t *other_msg_sent, *other_msg_received;  /* NULL in one direction. */
     size_t *finished;
+    hda_state_t *state;
+    targets_t *targets;
+    trace_t *trace;
+    int weight;
+    int keep;
 } hda_argument_t;
 
+typedef struct a_star_argument_t {
+    const maze_file_t *file;
+    const maze_t *other_maze;
+    const struct a_star_argument_t *other;  /* Opposite direction, NULL if none. */
+    maze_t *maze;
+    pthread_mutex_t *return_value_mutex;
+    a_star_return_t *return_value;
+    size_t thread_num;
+    size_t *finished;
+    int weight;                 /* Heuristic weight, WEIGHT_ONE for A*. */
+    int keep;                   /* Anytime: keep bounded-out nodes for later rounds. */
+    int connectivity;           /* 4 or 8 neighbours, picking the kernel. */
+    targets_t *targets;         /* One-to-many targets, NULL otherwise. */
+    trace_file_t *trace;        /* Trace of the threads, NULL if not traced. */
+    int direction;              /* 0 from the start, 1 from the goal, in the trace. */
+    /* per-thread resources, set up by a_star_init. */
+    hda_mq_t *mqs;
+    size_t *msg_sent, *msg_received;
+    hda_state_t *states;
+    hda_argument_t *args;
+} a_star_argument_t;
+
 void hda_mq_init(hda_mq_t *mq) {
     mq->head = NULL;
     mq->start_chunk = mmap(
@@ -112,7 +201,7 @@ void hda_mq_init(hda_mq_t *mq) {
     mq->end_chunk = mq->start_chunk;
     mq->end_chunk_len = (hda_message_t *) mq->end_chunk + 1;
     mq->end_chunk_cap = (hda_message_t *) ((size_t) mq->end_chunk + MSG_MEM_MAP_SIZE) - 1;
-    *(void **) mq = NULL;
+    *(void **) mq->start_chunk = NULL;
     mq->bin = NULL;
 }
 
@@ -154,298 +243,1120 @@ void hda_mq_destroy(hda_mq_t *mq) {
     }
 }
 
-void *hda_star_search(hda_argument_t *args) {
-    mem_pool_t mem_pool;
-    heap_t heap;
-    node_t *node, *other_node;
-    hda_message_t *msg_start, *msg, *next_msg;
-    size_t *msg_sent = &args->msg_sent[args->thread_id];
-    size_t *msg_received = &args->msg_received[args->thread_id];
-    hda_mq_t *msg_queue = &args->mqs[args->thread_id];
-
-    /* init and set up cleanups. */
-    mem_pool_init(&mem_pool);
-    heap_init(&heap);
-    /* add start. */
-    if (hash_distribute(args->thread_num, args->maze->start_x, args->maze->start_y) ==
-        args->thread_id) {
-        /* initialize first node. */
-        ++*msg_sent;
-        node = node_init(alloc_node(&mem_pool), args->maze->start_x, args->maze->start_y);
-        node->gs = 1;
-        node->fs = 1 + heuristic(node, get_goal(args->maze));
-        /* modify maze.nodes. */
-        maze_node(args->maze, args->maze->start_x, args->maze->start_y) = node;
-        /* insert first node. */
-        heap_insert(&heap, node);
-    }
-
-    /* main loop. */
-    while (!*args->finished) {
-        if (heap.size > 1) {
-            /* if there are nodes in heap. */
-            node = heap_extract(&heap);
-            /* if the node is worse than currently found best path */
-            if (node->gs >= args->return_value->min_len) {
-                /* dump heap and add number of nodes to message received. */
-                *msg_received += heap.size;
-                heap.size = 1;
-                continue;
-            }
-            /* if the node is opened in another list. */
-            other_node = maze_node(args->other_maze, node->x, node->y);
-            if (other_node != NULL) {
-                int last_len, len = node->gs + other_node->gs;
-                /* update current best path. */
-                assert(!pthread_mutex_lock(args->return_value_mutex));
-                last_len = args->return_value->min_len;
-                if (len < last_len) {
-                    args->return_value->min_len = len;
-                    args->return_value->x = node->x;
-                    args->return_value->y = node->y;
-                }
-                assert(!pthread_mutex_unlock(args->return_value_mutex));
-            } else {
-                int x_axis[4], y_axis[4];
-                int gs;
-                size_t i;
-                size_t id;
-                /* initial four direction. */
-                x_axis[0] = node->x + 1;
-                y_axis[0] = node->y;
-                x_axis[1] = node->x - 1;
-                y_axis[1] = node->y;
-                x_axis[2] = node->x;
-                y_axis[2] = node->y + 1;
-                x_axis[3] = node->x;
-                y_axis[3] = node->y - 1;
-                gs = node->gs + 1;
-                /* Check all the neighbours. */
-                for (i = 0; i < 4; ++i) {
-                    /* send if not wall. */
-                    if (maze_lines(args->file, x_axis[i], y_axis[i]) != '#') {
-                        node_t *origin = maze_node(args->maze, x_axis[i], y_axis[i]);
-                        if (origin == NULL || gs < origin->gs) {
-                            hda_message_t *new_msg;
-                            hda_mq_t *mq;
-                            /* pick msg queue. */
-                            id = hash_distribute(args->thread_num, x_axis[i], y_axis[i]);
-                            mq = &args->mqs[id];
-                            /* allocate new message. */
-                            new_msg = alloc_msg(msg_queue);
-                            new_msg->parent = node;
-                            new_msg->x = x_axis[i];
-                            new_msg->y = y_axis[i];
-                            new_msg->gs = gs;
-                            /* message sent add one */
-                            ++*msg_sent;
-                            /* send message. */
-							do {
-								new_msg->next = mq->head;
-							} while (!__atomic_compare_exchange_n(&mq->head, &new_msg->next, new_msg, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
-							/*
-                            __asm__ __volatile__(
-                            "       mov         %E[ptr], %%rax;     "
-                            "hda_mq_send_loop:                      "
-                            "       mov         %%rax, %E[next];    "
-                            "lock   cmpxchg     %[msg], %E[ptr];    "
-                            "       jne         hda_mq_send_loop;   "
-                            :
-                            :[ptr] "r"(&mq->head),[next] "r"(&new_msg->next),[msg] "r"(new_msg)
-                            :"rax", "cc", "memory");*/
-                        }
-                    }
-                }
-            }
-            /* message received add one */
-            ++*msg_received;
-        } else {
-            /* no nodes in heap. */
-            while (msg_queue->head == NULL) {
-                size_t msg_sent_sum = 0, msg_received_sum = 0, i;
-                /* barrier hit. If end, thread will stuck here and wait for cancel. */
-                for (i = 0; i < args->thread_num; i++)
-                    msg_received_sum += args->msg_received[i];
-                for (i = 0; i < args->thread_num; i++)
-                    msg_sent_sum += args->msg_sent[i];
-                if (*args->finished ||
-                    (args->return_value->min_len < INT_MAX && msg_sent_sum == msg_received_sum)) {
-                    *args->finished = 1;
-                    goto hda_star_search_end;
-                }
-            }
-        }
-        /* receive message. */
-		msg_start = __atomic_exchange_n(&msg_queue->head, NULL, __ATOMIC_ACQUIRE);
-		/*
-        msg_start = NULL;
-        __asm__ __volatile__(
-        "lock   xchg        %[msg], %E[ptr];    "
-        :[msg] "+r"(msg_start)
-        :[ptr] "r"(&msg_queue->head)
-        : "memory");
-		*/
-
-        msg = msg_start;
-        if (msg != NULL) {
-            /* add all nodes in message queue. */
-            while (1) {
-                node_t **adj_ptr = &maze_node(args->maze, msg->x, msg->y);
-                node_t *adj = *adj_ptr;
-                /* if NULL, the node is not opened */
-                if (adj == NULL) {
-                    /* allocate new node and modify maze.nodes. */
-                    adj = node_init(alloc_node(&mem_pool), msg->x, msg->y);
-                    *adj_ptr = adj;
-                }
-
-                /* update if improved. */
-                if (msg->gs < adj->gs) {
-                    /* modify node. */
-                    adj->parent = msg->parent;
-                    adj->gs = msg->gs;
-                    adj->fs = adj->gs + heuristic(adj, get_goal(args->maze));
-                    if (adj->heap_id != 0) {
-                        heap_update(&heap, adj);
-                        ++*msg_received;
-                    } else {
-                        heap_insert(&heap, adj);
-                    }
-                } else {
-                    ++*msg_received;
-                }
-                next_msg = msg->next;
-                if (next_msg == NULL) break;
-                msg = next_msg;
-            }
-            free_msg(msg_queue, msg_start, msg);
-        }
+/**
+ * Set node N aside until the next round of a weighted search.
+ */
+void hda_keep(hda_state_t *state, node_t *node) {
+    if (state->incons_len == state->incons_cap) {
+        state->incons_cap *= 2;
+        state->incons = realloc(state->incons, state->incons_cap * sizeof(node_t *));
+        assert(state->incons != NULL);
     }
+    state->incons[state->incons_len++] = node;
+}
 
-    hda_star_search_end:
-    mem_pool_destroy(&mem_pool);
-    heap_destroy(&heap);
-    return NULL;
+/**
+ * Record that node N, maybe a target, is reached with g-score GS. When all
+ *   targets are reached, bound the search by the farthest one: no node with
+ *   a larger g-score can improve any of them.
+ */
+void hda_reach(hda_argument_t *args, node_t *node, int gs) {
+    targets_t *targets = args->targets;
+    int t = targets->index[(size_t) node->y * args->file->cols + node->x], i, bound = 0;
+    if (t < 0) return;
+    pthread_mutex_lock(args->return_value_mutex);
+    if (targets->gs[t] == INT_MAX) targets->reached++;
+    if (gs < targets->gs[t]) targets->gs[t] = gs;
+    if (targets->reached == targets->distinct) {
+        for (i = 0; i < targets->distinct; i++)
+            if (targets->gs[i] > bound) bound = targets->gs[i];
+        if (bound < args->return_value->min_len) args->return_value->min_len = bound;
+    }
+    pthread_mutex_unlock(args->return_value_mutex);
 }
 
-void *a_star_search(a_star_argument_t *arguments) {
-    pthread_t *threads = NULL;
-    hda_mq_t *message_queue = NULL;
-    size_t *msg_sent = NULL;
-    size_t *msg_received = NULL;
-    hda_argument_t *args_for_threads = NULL;
-    size_t i = 0;
-    /* initialize and set up cleanups. */
-    threads = malloc(arguments->thread_num * sizeof(pthread_t));
-    message_queue = malloc(arguments->thread_num * sizeof(hda_mq_t));
-    msg_sent = malloc(arguments->thread_num * sizeof(size_t));
-    msg_received = malloc(arguments->thread_num * sizeof(size_t));
-    args_for_threads = malloc(arguments->thread_num * sizeof(hda_argument_t));
+/* Search kernels, one per connectivity and heuristic combination. */
+#define HDA_KERNEL_SUFFIX       _4
+#define HDA_KERNEL_HEURISTIC    heuristic_manhattan
+#define HDA_KERNEL_EXPAND       HDA_EXPAND_4
+#include "hda_kernel.h"
+
+#define HDA_KERNEL_SUFFIX       _4_alt
+#define HDA_KERNEL_HEURISTIC    heuristic
+#define HDA_KERNEL_EXPAND       HDA_EXPAND_4
+#include "hda_kernel.h"
+
+#define HDA_KERNEL_SUFFIX       _8
+#define HDA_KERNEL_HEURISTIC    heuristic_octile
+#define HDA_KERNEL_EXPAND       HDA_EXPAND_8
+/* unequal step costs: stopping at meeting cells may cut off the shortest path. */
+#define HDA_KERNEL_THROUGH      1
+#include "hda_kernel.h"
+
+#define HDA_KERNEL_SUFFIX       _4_large
+#define HDA_KERNEL_HEURISTIC    heuristic_manhattan
+#define HDA_KERNEL_EXPAND       HDA_EXPAND_4
+#define HDA_KERNEL_GET          maze_sparse_get
+#define HDA_KERNEL_PUT          maze_sparse_put
+#include "hda_kernel.h"
+
+
+/**
+ * Set up the per-thread resources of one search direction. They live until
+ *   a_star_destroy, so that nodes stay valid for path printing and for later
+ *   rounds.
+ */
+void a_star_init(a_star_argument_t *arguments) {
+    size_t i;
+    arguments->mqs = malloc(arguments->thread_num * sizeof(hda_mq_t));
+    arguments->msg_sent = malloc(arguments->thread_num * sizeof(size_t));
+    arguments->msg_received = malloc(arguments->thread_num * sizeof(size_t));
+    arguments->states = malloc(arguments->thread_num * sizeof(hda_state_t));
+    arguments->args = malloc(arguments->thread_num * sizeof(hda_argument_t));
     /* initialize thread each variables. */
     for (i = 0; i < arguments->thread_num; i++) {
-        hda_mq_init(message_queue + i);
-        msg_sent[i] = 0;
-        msg_received[i] = 0;
-        args_for_threads[i].file = arguments->file;
-        args_for_threads[i].other_maze = arguments->other_maze;
-        args_for_threads[i].maze = arguments->maze;
-        args_for_threads[i].return_value_mutex = arguments->return_value_mutex;
-        args_for_threads[i].return_value = arguments->return_value;
-        args_for_threads[i].thread_num = arguments->thread_num;
-        args_for_threads[i].thread_id = i;
-        args_for_threads[i].mqs = message_queue;
-        args_for_threads[i].msg_sent = msg_sent;
-        args_for_threads[i].msg_received = msg_received;
-        args_for_threads[i].finished = arguments->finished;
+        hda_state_t *state = arguments->states + i;
+        hda_mq_init(arguments->mqs + i);
+        mem_pool_init(&state->mem_pool);
+        heap_init(&state->heap);
+        state->incons_cap = INIT_CAPACITY;
+        state->incons_len = 0;
+        state->incons = malloc(state->incons_cap * sizeof(node_t *));
+        arguments->msg_sent[i] = 0;
+        arguments->msg_received[i] = 0;
+        arguments->args[i].file = arguments->file;
+        arguments->args[i].other_maze = arguments->other_maze;
+        arguments->args[i].maze = arguments->maze;
+        arguments->args[i].return_value_mutex = arguments->return_value_mutex;
+        arguments->args[i].return_value = arguments->return_value;
+        arguments->args[i].thread_num = arguments->thread_num;
+        arguments->args[i].thread_id = i;
+        arguments->args[i].mqs = arguments->mqs;
+        arguments->args[i].msg_sent = arguments->msg_sent;
+        arguments->args[i].msg_received = arguments->msg_received;
+        arguments->args[i].finished = arguments->finished;
+        arguments->args[i].state = state;
+        arguments->args[i].targets = arguments->targets;
+        arguments->args[i].trace = arguments->trace == NULL ? NULL :
+                                   trace_init(arguments->trace, arguments->direction, (int) i);
     }
+}
 
+/**
+ * Start ROUTINE on ARG in THREAD. A thread that cannot be created is fatal,
+ *   since its siblings would wait for it forever.
+ */
+void thread_start(pthread_t *thread, void *(*routine)(void *), void *arg) {
+    if (pthread_create(thread, NULL, routine, arg) != 0) {
+        fprintf(stderr, "cannot create thread\n");
+        exit(1);
+    }
+}
+
+/**
+ * Run one round of the search direction with the current weight.
+ */
+void *a_star_search(a_star_argument_t *arguments) {
+    pthread_t *threads = malloc(arguments->thread_num * sizeof(pthread_t));
+    void *(*kernel)(hda_argument_t *) = hda_star_search_4;
+    size_t i;
+    if (arguments->maze->nodes == NULL) kernel = hda_star_search_4_large;
+    else if (arguments->connectivity == 8) kernel = hda_star_search_8;
+    else if (compass_landmarks != NULL) kernel = hda_star_search_4_alt;
+    for (i = 0; i < arguments->thread_num; i++) {
+        arguments->args[i].weight = arguments->weight;
+        arguments->args[i].keep = arguments->keep;
+        /* both directions are set up by now. */
+        arguments->args[i].other_msg_sent = arguments->other == NULL ? NULL : arguments->other->msg_sent;
+        arguments->args[i].other_msg_received = arguments->other == NULL ? NULL :
+                                                arguments->other->msg_received;
+    }
     /* launch threads. */
     for (i = 0; i < arguments->thread_num; i++)
-        assert(!pthread_create(threads + i, NULL, (void *(*)(void *)) hda_star_search, args_for_threads + i));
+        thread_start(threads + i, (void *(*)(void *)) kernel, arguments->args + i);
     /* join all the threads. */
     for (i = 0; i < arguments->thread_num; i++)
-        assert(!pthread_join(threads[i], NULL));
-    for (i = 0; i < arguments->thread_num; i++)
-        hda_mq_destroy(message_queue + i);
+        pthread_join(threads[i], NULL);
     free(threads);
-    free(message_queue);
-    free(msg_sent);
-    free(msg_received);
-    free(args_for_threads);
     return NULL;
 }
 
+void a_star_destroy(a_star_argument_t *arguments) {
+    size_t i;
+    for (i = 0; i < arguments->thread_num; i++) {
+        hda_mq_destroy(arguments->mqs + i);
+        mem_pool_destroy(&arguments->states[i].mem_pool);
+        heap_destroy(&arguments->states[i].heap);
+        free(arguments->states[i].incons);
+        if (arguments->args[i].trace != NULL) trace_destroy(arguments->args[i].trace);
+    }
+    free(arguments->mqs);
+    free(arguments->msg_sent);
+    free(arguments->msg_received);
+    free(arguments->states);
+    free(arguments->args);
+}
+
+/**
+ * Deadline of an anytime search. Once expired, the running round is told to
+ *   finish and no further round starts.
+ */
+typedef struct deadline_t {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct timespec at;
+    int done;                   /* Search over before the deadline. */
+    int expired;
+    size_t *finished;
+} deadline_t;
+
+void *deadline_watch(deadline_t *deadline) {
+    pthread_mutex_lock(&deadline->mutex);
+    while (!deadline->done) {
+        if (pthread_cond_timedwait(&deadline->cond, &deadline->mutex, &deadline->at) == ETIMEDOUT) {
+            deadline->expired = 1;
+            *deadline->finished = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&deadline->mutex);
+    return NULL;
+}
+
+/**
+ * Collect the path through the meeting cell of RETURN_VALUE into PATH.
+ */
+void collect_path(const a_star_argument_t *argument_start, const a_star_argument_t *argument_goal,
+                  const a_star_return_t *return_value, path_t *path) {
+    node_t *node;
+    for (node = maze_get(argument_start->maze, return_value->x, return_value->y)->parent;
+         node != NULL; node = node->parent)
+        path_push(path, node->x, node->y);
+    path_reverse(path);
+    path_push(path, return_value->x, return_value->y);
+    for (node = maze_get(argument_goal->maze, return_value->x, return_value->y)->parent;
+         node != NULL; node = node->parent)
+        path_push(path, node->x, node->y);
+}
+
+/**
+ * Anytime search: weighted rounds with a shrinking weight, reusing the open
+ *   and closed state, until the deadline of TIMEOUT_MS (none if 0) or an
+ *   optimal round. Prints the proven suboptimality bound after each round,
+ *   and on expiry the length of the best path with the bound of the last
+ *   finished round. Collects that path into PATH. Returns 0 if any path was
+ *   found.
+ */
+int anytime_search(a_star_argument_t *argument_start, a_star_argument_t *argument_goal,
+                   int weight, long timeout_ms, path_t *path) {
+    deadline_t deadline;
+    pthread_t watcher, from_start, from_goal;
+    a_star_return_t *return_value = argument_start->return_value;
+    int expired = 0, proven = 0;
+    pthread_mutex_init(&deadline.mutex, NULL);
+    pthread_cond_init(&deadline.cond, NULL);
+    deadline.done = 0;
+    deadline.expired = 0;
+    deadline.finished = argument_start->finished;
+    argument_start->keep = argument_goal->keep = 1;
+    if (timeout_ms > 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline.at);
+        deadline.at.tv_sec += timeout_ms / 1000;
+        deadline.at.tv_nsec += timeout_ms % 1000 * 1000000;
+        if (deadline.at.tv_nsec >= 1000000000) {
+            deadline.at.tv_sec++;
+            deadline.at.tv_nsec -= 1000000000;
+        }
+        thread_start(&watcher, (void *(*)(void *)) deadline_watch, &deadline);
+    }
+
+    while (1) {
+        argument_start->weight = argument_goal->weight = weight;
+        thread_start(&from_start, (void *(*)(void *)) a_star_search, argument_start);
+        thread_start(&from_goal, (void *(*)(void *)) a_star_search, argument_goal);
+        pthread_join(from_start, NULL);
+        pthread_join(from_goal, NULL);
+        pthread_mutex_lock(&deadline.mutex);
+        expired = deadline.expired;
+        if (!expired) *argument_start->finished = 0;
+        pthread_mutex_unlock(&deadline.mutex);
+        if (expired || return_value->overflow) break;
+        /* an unbounded round only ends once the goal proved unreachable. */
+        if (return_value->min_len == INT_MAX) break;
+        printf("bound %.3f length %d\n", (double) weight / WEIGHT_ONE, return_value->min_len - 1);
+        proven = weight;
+        if (weight == WEIGHT_ONE) break;
+        /* halve the excess weight, snapping to A* when it gets small. */
+        weight = WEIGHT_ONE + (weight - WEIGHT_ONE) / 2;
+        if (weight - WEIGHT_ONE < WEIGHT_ONE / 20) weight = WEIGHT_ONE;
+    }
+
+    if (timeout_ms > 0) {
+        pthread_mutex_lock(&deadline.mutex);
+        deadline.done = 1;
+        pthread_cond_signal(&deadline.cond);
+        pthread_mutex_unlock(&deadline.mutex);
+        pthread_join(watcher, NULL);
+    }
+    pthread_cond_destroy(&deadline.cond);
+    pthread_mutex_destroy(&deadline.mutex);
+    if (return_value->overflow) {
+        fprintf(stderr, "path too long to search\n");
+        return -1;
+    }
+    if (return_value->min_len == INT_MAX) {
+        fprintf(stderr, expired ? "no path found before the deadline\n" : "no path found\n");
+        return -1;
+    }
+    /* the parents kept improving after the meeting was recorded, so the
+     * length is the one of the collected path. */
+    collect_path(argument_start, argument_goal, return_value, path);
+    if (expired && proven > 0)
+        printf("deadline length %d bound %.3f\n", path->len, (double) proven / WEIGHT_ONE);
+    else if (expired)
+        printf("deadline length %d bound none\n", path->len);
+    return 0;
+}
+
+/**
+ * Search a shortest path between the entrances of FILE into PATH, with two
+ *   HDA* directions sharing THREAD_NUM threads, moving to CONNECTIVITY (4 or
+ *   8) neighbours. LARGE keeps the search state in sparse tables rather than
+ *   one pointer per cell. A positive WEIGHT runs the anytime search from
+ *   that weight, within TIMEOUT_MS if positive. The threads record into
+ *   TRACE unless NULL. Returns 0 if a path was found.
+ */
+int bidirectional_search(const maze_file_t *file, size_t thread_num, int connectivity, int large,
+                         int weight, long timeout_ms, trace_file_t *trace, path_t *path) {
+    /* each direction needs a thread of its own. */
+    size_t direction_num = thread_num < 2 ? 1 : thread_num / 2;
+    maze_t *maze_start, *maze_goal;
+    pthread_mutex_t return_value_mutex;
+    a_star_return_t return_value;
+    size_t finished = 0;
+    a_star_argument_t argument_start, argument_goal;
+    pthread_t from_start, from_goal;
+    int ret = 0;
+    if (large) {
+        /* segmented by owner thread, as the messages are. */
+        maze_start = maze_init_sparse(file->cols, 1, 1, file->cols - 1, file->rows - 2, direction_num);
+        maze_goal = maze_init_sparse(file->cols, file->cols - 2, file->rows - 2, 0, 1, direction_num);
+    } else {
+        maze_start = maze_init(file->cols, file->rows, 1, 1, file->cols - 1, file->rows - 2);
+        maze_goal = maze_init(file->cols, file->rows, file->cols - 2, file->rows - 2, 0, 1);
+    }
+    pthread_mutex_init(&return_value_mutex, NULL);
+    return_value.min_len = INT_MAX;
+    return_value.overflow = 0;
+    return_value.x = -1;
+    return_value.y = -1;
+    /* shared arguments. */
+    argument_start.file = file;
+    argument_goal.file = file;
+    argument_start.other_maze = maze_goal;
+    argument_goal.other_maze = maze_start;
+    argument_start.other = &argument_goal;
+    argument_goal.other = &argument_start;
+    argument_start.maze = maze_start;
+    argument_goal.maze = maze_goal;
+    argument_start.return_value_mutex = &return_value_mutex;
+    argument_goal.return_value_mutex = &return_value_mutex;
+    argument_start.return_value = &return_value;
+    argument_goal.return_value = &return_value;
+    argument_start.thread_num = direction_num;
+    argument_goal.thread_num = direction_num;
+    argument_start.finished = &finished;
+    argument_goal.finished = &finished;
+    argument_start.weight = WEIGHT_ONE;
+    argument_goal.weight = WEIGHT_ONE;
+    argument_start.keep = 0;
+    argument_goal.keep = 0;
+    argument_start.connectivity = connectivity;
+    argument_goal.connectivity = connectivity;
+    argument_start.targets = NULL;
+    argument_goal.targets = NULL;
+    argument_start.trace = trace;
+    argument_goal.trace = trace;
+    argument_start.direction = 0;
+    argument_goal.direction = 1;
+    a_star_init(&argument_start);
+    a_star_init(&argument_goal);
+
+    if (weight > 0) {
+        ret = anytime_search(&argument_start, &argument_goal, weight, timeout_ms, path);
+    } else {
+        /* create two threads. */
+        thread_start(&from_start, (void *(*)(void *)) a_star_search, &argument_start);
+        thread_start(&from_goal, (void *(*)(void *)) a_star_search, &argument_goal);
+        /* join two threads thread. */
+        pthread_join(from_start, NULL);
+        pthread_join(from_goal, NULL);
+        if (return_value.overflow) fprintf(stderr, "path too long to search\n");
+        if (return_value.overflow || return_value.min_len == INT_MAX) ret = -1;
+        else collect_path(&argument_start, &argument_goal, &return_value, path);
+    }
+
+    a_star_destroy(&argument_start);
+    a_star_destroy(&argument_goal);
+    maze_destroy(maze_start);
+    maze_destroy(maze_goal);
+    pthread_mutex_destroy(&return_value_mutex);
+    return ret;
+}
+
+/**
+ * Name of the cache file with SUFFIX next to the maze FILENAME. The caller
+ *   frees it.
+ */
+char *cache_name(const char *filename, const char *suffix) {
+    char *cache = malloc(strlen(filename) + strlen(suffix) + 1);
+    assert(cache != NULL);
+    strcpy(cache, filename);
+    strcat(cache, suffix);
+    return cache;
+}
+
+/**
+ * Load the landmarks cached next to the maze FILENAME, or compute and cache
+ *   them if the cache is missing or stale. Returns the landmarks.
+ */
+landmark_t *load_landmarks(const char *filename, const maze_file_t *file, int count,
+                           size_t thread_num) {
+    char *cache = cache_name(filename, ".alt");
+    landmark_t *lm = landmark_load(cache, file, count);
+    if (lm == NULL) {
+        lm = landmark_init(file, count, 1, 1, thread_num);
+        if (landmark_save(lm, file, cache) != 0)
+            fprintf(stderr, "warning: cannot save landmarks to %s\n", cache);
+    }
+    free(cache);
+    return lm;
+}
+
+/**
+ * Load the hierarchical index cached next to the maze FILENAME, or build and
+ *   cache it if the cache is missing or stale, or if REBUILD is set. Returns
+ *   the index.
+ */
+hpa_t *load_hpa(const char *filename, const maze_file_t *file, int cluster, size_t thread_num,
+                int rebuild) {
+    char *cache = cache_name(filename, ".hpa");
+    hpa_t *hpa = rebuild ? NULL : hpa_load(cache, file, cluster);
+    if (hpa == NULL) {
+        hpa = hpa_init(file, cluster, thread_num);
+        if (hpa_save(hpa, file, cache) != 0)
+            fprintf(stderr, "warning: cannot save hierarchical index to %s\n", cache);
+    }
+    free(cache);
+    return hpa;
+}
+
+/**
+ * Incremental mode: plan once, then read cell toggles "X Y" from EDITS, one
+ *   per line, replanning after each blank line and after trailing toggles at
+ *   the end of input. The final path on the edited maze goes to PATH.
+ */
+void replan_edits(maze_file_t *file, FILE *edits, path_t *path) {
+    lpa_t *lpa = lpa_init(file, 1, 1, file->cols - 2, file->rows - 2);
+    char line[256];
+    int pending = 0, len, x, y;
+    len = lpa_replan(lpa);
+    printf("length %d expanded %lu\n", len, (unsigned long) lpa->expanded);
+    while (1) {
+        int end = fgets(line, sizeof(line), edits) == NULL;
+        if (!end && sscanf(line, "%d %d", &x, &y) == 2) {
+            if (lpa_toggle(lpa, x, y) != 0)
+                fprintf(stderr, "warning: cannot toggle cell %d %d\n", x, y);
+            else
+                pending = 1;
+        } else if (!end || pending) {
+            len = lpa_replan(lpa);
+            printf("length %d expanded %lu\n", len, (unsigned long) lpa->expanded);
+            pending = 0;
+        }
+        if (end) break;
+    }
+    lpa_path(lpa, path);
+    lpa_destroy(lpa);
+}
+
+/**
+ * The entrances are walled by maze_file_init, so a search reaches them
+ *   through their only open neighbour. Moves (*X, *Y) from an entrance onto
+ *   that neighbour and returns the extra step, 0 for any other cell.
+ */
+int entrance_inner(const maze_file_t *file, int *x, int *y) {
+    if (*x == 0 && *y == 1) {
+        *x = 1;
+        return 1;
+    }
+    if (*x == file->cols - 1 && *y == file->rows - 2) {
+        *x = file->cols - 2;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Steps from the source of the settled search MAZE to cell (X, Y) of FILE,
+ *   -1 if it is a wall or unreachable.
+ */
+int cell_steps(const maze_t *maze, const maze_file_t *file, int x, int y) {
+    int extra = entrance_inner(file, &x, &y);
+    if (maze_lines(file, x, y) == '#' || maze_node(maze, x, y) == NULL) return -1;
+    return maze_node(maze, x, y)->gs - 1 + extra;
+}
+
+/**
+ * Read targets "X Y" from IN, one per line, for a one-to-many search on
+ *   FILE. Targets off the maze or on walls are kept for the report but never
+ *   bound the search. Returns the targets.
+ */
+targets_t *targets_read(FILE *in, const maze_file_t *file) {
+    targets_t *targets = malloc(sizeof(targets_t));
+    size_t size = (size_t) file->rows * file->cols, i;
+    char line[256];
+    int x, y;
+    assert(targets != NULL);
+    targets->num = 0;
+    targets->capacity = INIT_CAPACITY;
+    targets->xs = malloc(targets->capacity * sizeof(int));
+    targets->ys = malloc(targets->capacity * sizeof(int));
+    targets->distinct = 0;
+    targets->reached = 0;
+    targets->index = malloc(size * sizeof(int));
+    assert(targets->xs != NULL && targets->ys != NULL && targets->index != NULL);
+    for (i = 0; i < size; i++) targets->index[i] = -1;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (sscanf(line, "%d %d", &x, &y) != 2) continue;
+        if (targets->num == targets->capacity) {
+            targets->capacity *= 2;
+            targets->xs = realloc(targets->xs, targets->capacity * sizeof(int));
+            targets->ys = realloc(targets->ys, targets->capacity * sizeof(int));
+            assert(targets->xs != NULL && targets->ys != NULL);
+        }
+        targets->xs[targets->num] = x;
+        targets->ys[targets->num] = y;
+        targets->num++;
+        if (x < 0 || y < 0 || x >= file->cols || y >= file->rows) {
+            fprintf(stderr, "warning: target %d %d is off the maze\n", x, y);
+            continue;
+        }
+        /* an entrance is settled with its neighbour. */
+        entrance_inner(file, &x, &y);
+        if (maze_lines(file, x, y) != '#' &&
+            targets->index[(size_t) y * file->cols + x] < 0) {
+            targets->index[(size_t) y * file->cols + x] = targets->distinct++;
+        }
+    }
+    targets->gs = malloc((targets->distinct + 1) * sizeof(int));
+    assert(targets->gs != NULL);
+    for (x = 0; x < targets->distinct; x++) targets->gs[x] = INT_MAX;
+    return targets;
+}
+
+void targets_destroy(targets_t *targets) {
+    free(targets->xs);
+    free(targets->ys);
+    free(targets->gs);
+    free(targets->index);
+    free(targets);
+}
+
+/**
+ * Save the distance field of MAZE from (SOURCE_X, SOURCE_Y) to FILENAME: a
+ *   header {magic, rows, cols, source x, source y} followed by the steps to
+ *   each cell in row-major order, FIELD_UNREACHABLE if it is not reached.
+ *   Returns 0 on success, -1 on failure.
+ */
+int field_save(const maze_t *maze, const maze_file_t *file, int source_x, int source_y,
+               const char *filename) {
+    FILE *out = fopen(filename, "wb");
+    unsigned int *row;
+    int header[5];
+    int ok, x, y;
+    if (out == NULL) return -1;
+    row = malloc(file->cols * sizeof(unsigned int));
+    assert(row != NULL);
+    header[0] = FIELD_MAGIC;
+    header[1] = file->rows;
+    header[2] = file->cols;
+    header[3] = source_x;
+    header[4] = source_y;
+    ok = fwrite(header, sizeof(int), 5, out) == 5;
+    for (y = 0; ok && y < file->rows; y++) {
+        for (x = 0; x < file->cols; x++) {
+            int steps = cell_steps(maze, file, x, y);
+            row[x] = steps < 0 ? FIELD_UNREACHABLE : (unsigned int) steps;
+        }
+        ok = fwrite(row, sizeof(unsigned int), (size_t) file->cols, out) == (size_t) file->cols;
+    }
+    free(row);
+    if (fclose(out) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+/**
+ * One-to-many mode: a single HDA* direction from (SOURCE_X, SOURCE_Y) with
+ *   zero heuristic weight, so every cell is settled in order of distance.
+ *   Stops once all TARGETS are settled, or floods the whole maze when the
+ *   distance field is written to FIELD. Prints "X Y steps" per target, -1
+ *   if unreachable. The threads record into TRACE unless NULL. Returns 0 on
+ *   success.
+ */
+int one_to_many(const maze_file_t *file, int source_x, int source_y, targets_t *targets,
+                const char *field, size_t thread_num, trace_file_t *trace) {
+    maze_t *maze = maze_init(file->cols, file->rows, source_x, source_y, source_x, source_y);
+    pthread_mutex_t return_value_mutex;
+    a_star_return_t return_value;
+    a_star_argument_t argument;
+    size_t finished = 0;
+    int ret = 0, i;
+    pthread_mutex_init(&return_value_mutex, NULL);
+    return_value.min_len = INT_MAX;
+    return_value.overflow = 0;
+    return_value.x = -1;
+    return_value.y = -1;
+    argument.file = file;
+    argument.other_maze = NULL;
+    argument.other = NULL;
+    argument.maze = maze;
+    argument.return_value_mutex = &return_value_mutex;
+    argument.return_value = &return_value;
+    argument.thread_num = thread_num;
+    argument.finished = &finished;
+    argument.weight = 0;
+    argument.keep = 0;
+    argument.connectivity = 4;
+    argument.targets = field == NULL ? targets : NULL;
+    argument.trace = trace;
+    argument.direction = 0;
+    a_star_init(&argument);
+    if (field != NULL || targets == NULL || targets->distinct > 0) a_star_search(&argument);
+
+    if (return_value.overflow) {
+        /* cells past the cut would read as unreachable. */
+        fprintf(stderr, "paths too long to search\n");
+        a_star_destroy(&argument);
+        maze_destroy(maze);
+        pthread_mutex_destroy(&return_value_mutex);
+        return 1;
+    }
+    if (field != NULL && field_save(maze, file, source_x, source_y, field) != 0) {
+        fprintf(stderr, "cannot save distance field to %s\n", field);
+        ret = 1;
+    }
+    for (i = 0; targets != NULL && i < targets->num; i++) {
+        int x = targets->xs[i], y = targets->ys[i], steps = -1;
+        if (x >= 0 && y >= 0 && x < file->cols && y < file->rows)
+            steps = cell_steps(maze, file, x, y);
+        printf("%d %d %d\n", x, y, steps);
+    }
+
+    a_star_destroy(&argument);
+    maze_destroy(maze);
+    pthread_mutex_destroy(&return_value_mutex);
+    return ret;
+}
+
+/**
+ * Whether OUT_NAME names the source of FILE, under whatever path.
+ */
+int same_file(const maze_file_t *file, const char *out_name) {
+    struct stat source, out;
+    if (fstat(file->fd, &source) == -1 || stat(out_name, &out) == -1) return 0;
+    return source.st_dev == out.st_dev && source.st_ino == out.st_ino;
+}
+
+/**
+ * Write PATH on the maze FILE, read from FILENAME, in FORMAT to OUT_NAME
+ *   (- for stdout). Without OUT_NAME, or with OUT_NAME being the source, only
+ *   the path cells of the source are marked in place: truncating it would
+ *   pull the mapping from under the maze. Returns 0 on success.
+ */
+int write_path(const path_t *path, const maze_file_t *file, const char *filename,
+               const char *out_name, int format) {
+    FILE *out;
+    int ok;
+    if (out_name != NULL && strcmp(out_name, "-") != 0 && same_file(file, out_name)) {
+        if (format != OUTPUT_MAZE) {
+            fprintf(stderr, "refusing to write the path over the maze %s\n", filename);
+            return 1;
+        }
+        out_name = NULL;
+    }
+    if (out_name == NULL) {
+        if (path_write_back(path, file, filename) == 0) return 0;
+        fprintf(stderr, "cannot write the path back to %s\n", filename);
+        return 1;
+    }
+    out = strcmp(out_name, "-") == 0 ? stdout : fopen(out_name, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "cannot open %s\n", out_name);
+        return 1;
+    }
+    if (format == OUTPUT_RLE) ok = path_write_rle(path, out) == 0;
+    else if (format == OUTPUT_DIR) ok = path_write_dir(path, out) == 0;
+    else ok = path_write_maze(path, file, out) == 0;
+    if (out == stdout ? fflush(out) != 0 : fclose(out) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "cannot write the path to %s\n", out_name);
+    return ok ? 0 : 1;
+}
+
+/**
+ * A maze of a batch, loaded ahead of its search.
+ */
+typedef struct batch_job_t {
+    char *name;                 /* Source file name. */
+    maze_file_t *file;
+} batch_job_t;
+
+/**
+ * Batch scheduler. A loader thread maps the listed mazes into a bounded
+ *   queue while the workers solve earlier ones. Small mazes run the serial
+ *   search, one per worker; a large maze waits for the running ones, then
+ *   gets every thread for HDA* while the other workers hold off.
+ */
+typedef struct batch_t {
+    FILE *list;                 /* Maze file names, one per line. */
+    size_t thread_num;
+    int format;                 /* Path format, -1 to mark in place. */
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_cond_t gate;        /* Signalled as searches start and end. */
+    batch_job_t queue[BATCH_QUEUE_SIZE];
+    size_t head;
+    size_t len;
+    int loaded;                 /* The list is exhausted. */
+    size_t running;             /* Small searches running. */
+    int exclusive;              /* A large search waits or runs. */
+    size_t solved;
+    size_t failed;
+} batch_t;
+
+void *batch_load(batch_t *batch) {
+    char line[4096];
+    while (fgets(line, sizeof(line), batch->list) != NULL) {
+        size_t len = strlen(line);
+        batch_job_t job;
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (len == 0) continue;
+        job.file = maze_file_init(line);
+        if (job.file == NULL) {
+            fprintf(stderr, "cannot read maze %s\n", line);
+            pthread_mutex_lock(&batch->mutex);
+            batch->failed++;
+            pthread_mutex_unlock(&batch->mutex);
+            continue;
+        }
+        job.name = cache_name(line, "");
+        pthread_mutex_lock(&batch->mutex);
+        while (batch->len == BATCH_QUEUE_SIZE)
+            pthread_cond_wait(&batch->not_full, &batch->mutex);
+        batch->queue[(batch->head + batch->len) % BATCH_QUEUE_SIZE] = job;
+        batch->len++;
+        pthread_cond_signal(&batch->not_empty);
+        pthread_mutex_unlock(&batch->mutex);
+    }
+    pthread_mutex_lock(&batch->mutex);
+    batch->loaded = 1;
+    pthread_cond_broadcast(&batch->not_empty);
+    pthread_mutex_unlock(&batch->mutex);
+    return NULL;
+}
+
+/**
+ * Solve JOB of BATCH, taking the gate as a small or a large search.
+ *   Returns the number of cells on the path, -1 if there is none.
+ */
+int batch_solve(batch_t *batch, batch_job_t *job, path_t *path) {
+    const maze_file_t *file = job->file;
+    int large = (size_t) file->rows * file->cols >= BATCH_LARGE_AREA, len;
+    pthread_mutex_lock(&batch->mutex);
+    while (batch->exclusive) pthread_cond_wait(&batch->gate, &batch->mutex);
+    if (large) {
+        batch->exclusive = 1;
+        while (batch->running > 0) pthread_cond_wait(&batch->gate, &batch->mutex);
+    } else {
+        batch->running++;
+    }
+    pthread_mutex_unlock(&batch->mutex);
+
+    if (large) {
+        int sparse = (size_t) file->rows * file->cols >= MAZE_SPARSE_AREA;
+        len = bidirectional_search(file, batch->thread_num, 4, sparse, 0, 0, NULL, path) == 0 ?
+              path->len : -1;
+    } else {
+        len = serial_search(file, 1, 1, file->cols - 2, file->rows - 2, path);
+    }
+
+    pthread_mutex_lock(&batch->mutex);
+    if (large) batch->exclusive = 0;
+    else batch->running--;
+    pthread_cond_broadcast(&batch->gate);
+    pthread_mutex_unlock(&batch->mutex);
+    return len;
+}
+
+void *batch_work(batch_t *batch) {
+    static const char *suffixes[] = {".maze", ".rle", ".dir"};
+    while (1) {
+        batch_job_t job;
+        path_t *path;
+        int len, ret = 1;
+        pthread_mutex_lock(&batch->mutex);
+        while (batch->len == 0 && !batch->loaded)
+            pthread_cond_wait(&batch->not_empty, &batch->mutex);
+        if (batch->len == 0) {
+            pthread_mutex_unlock(&batch->mutex);
+            break;
+        }
+        job = batch->queue[batch->head];
+        batch->head = (batch->head + 1) % BATCH_QUEUE_SIZE;
+        batch->len--;
+        pthread_cond_signal(&batch->not_full);
+        pthread_mutex_unlock(&batch->mutex);
+
+        path = path_init();
+        len = batch_solve(batch, &job, path);
+        if (len >= 0 && batch->format < 0) {
+            ret = write_path(path, job.file, job.name, NULL, OUTPUT_MAZE);
+        } else if (len >= 0) {
+            char *out_name = cache_name(job.name, suffixes[batch->format]);
+            ret = write_path(path, job.file, job.name, out_name, batch->format);
+            free(out_name);
+        }
+        pthread_mutex_lock(&batch->mutex);
+        printf("%s %d\n", job.name, len);
+        if (ret == 0) batch->solved++;
+        else batch->failed++;
+        pthread_mutex_unlock(&batch->mutex);
+        path_destroy(path);
+        maze_file_destroy(job.file);
+        free(job.name);
+    }
+    return NULL;
+}
+
+/**
+ * Batch mode: solve every maze listed in LIST on a pool of THREAD_NUM
+ *   workers, printing "name length" as each finishes. Paths are marked in
+ *   place, or written next to each maze in FORMAT if it is not negative.
+ *   Returns 0 if every maze was solved.
+ */
+int batch_search(FILE *list, size_t thread_num, int format) {
+    batch_t batch;
+    pthread_t loader, *workers = malloc(thread_num * sizeof(pthread_t));
+    struct timespec begin, end;
+    double seconds;
+    size_t i;
+    assert(workers != NULL);
+    batch.list = list;
+    batch.thread_num = thread_num;
+    batch.format = format;
+    pthread_mutex_init(&batch.mutex, NULL);
+    pthread_cond_init(&batch.not_empty, NULL);
+    pthread_cond_init(&batch.not_full, NULL);
+    pthread_cond_init(&batch.gate, NULL);
+    batch.head = 0;
+    batch.len = 0;
+    batch.loaded = 0;
+    batch.running = 0;
+    batch.exclusive = 0;
+    batch.solved = 0;
+    batch.failed = 0;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    thread_start(&loader, (void *(*)(void *)) batch_load, &batch);
+    for (i = 0; i < thread_num; i++)
+        thread_start(workers + i, (void *(*)(void *)) batch_work, &batch);
+    pthread_join(loader, NULL);
+    for (i = 0; i < thread_num; i++)
+        pthread_join(workers[i], NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (double) (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    fprintf(stderr, "solved %lu failed %lu in %.3f s (%.1f mazes/s)\n", (unsigned long) batch.solved,
+            (unsigned long) batch.failed, seconds, seconds > 0 ? batch.solved / seconds : 0.0);
+    pthread_cond_destroy(&batch.gate);
+    pthread_cond_destroy(&batch.not_full);
+    pthread_cond_destroy(&batch.not_empty);
+    pthread_mutex_destroy(&batch.mutex);
+    free(workers);
+    return batch.failed == 0 ? 0 : 1;
+}
+
+/**
+ * Report that the trace NAME could not be written. Returns 1.
+ */
+int trace_fail(const char *name) {
+    fprintf(stderr, "cannot write trace %s\n", name);
+    return 1;
+}
+
+void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-l landmarks] [-c cluster] [-e edits] [-w weight] [-t ms]\n"
+                    "          [-s x,y] [-T targets] [-d field] [-o out] [-f format] [-8] [-L]\n"
+                    "          [-r trace] maze\n", name);
+    fprintf(stderr, "       %s -b list [-f format]\n", name);
+    fprintf(stderr, "  -l landmarks  use ALT heuristic with landmarks (1-%d) cached in maze.alt\n",
+            LANDMARK_MAX);
+    fprintf(stderr, "  -c cluster    search a hierarchical index of cluster-sized blocks cached\n"
+                    "                in maze.hpa\n");
+    fprintf(stderr, "  -e edits      replan incrementally after cell toggles read from edits\n"
+                    "                (\"x y\" per line, blank line replans, - for stdin)\n");
+    fprintf(stderr, "  -w weight     anytime search, starting from this heuristic weight\n");
+    fprintf(stderr, "  -t ms         anytime search, returning the best path found within ms\n");
+    fprintf(stderr, "  -s x,y        source of a one-to-many search (default 1,1)\n");
+    fprintf(stderr, "  -T targets    print the steps from the source to each target read from\n"
+                    "                targets (\"x y\" per line, - for stdin)\n");
+    fprintf(stderr, "  -d field      save the steps from the source to every cell to field\n");
+    fprintf(stderr, "  -o out        write the path to out (- for stdout) instead of marking\n"
+                    "                it on the maze in place\n");
+    fprintf(stderr, "  -f format     path format: maze (marked copy, the default), rle\n"
+                    "                (run-length steps) or dir (one step code per cell);\n"
+                    "                rle and dir go to stdout unless -o is given\n");
+    fprintf(stderr, "  -L            large maze: sparse search state, read on demand; plain\n"
+                    "                4-connected search only, the default past %d cells\n",
+            MAZE_SPARSE_AREA);
+    fprintf(stderr, "  -8            8-connected search with octile costs, no corner cutting;\n"
+                    "                plain search only\n");
+    fprintf(stderr, "  -r trace      record the events of every search thread to trace, for\n"
+                    "                astar-replay; not with -c, -e or -b\n");
+    fprintf(stderr, "  -b list       solve every maze listed in list (- for stdin) on a shared\n"
+                    "                pool; paths go next to each maze when -f is given\n");
+}
+
 /**
  * Entrance point. Time ticking will be performed on the whole procedure,
  *   including I/O. Parallel and optimize as much as you can.
  */
 int main(int argc, char *argv[]) {
     maze_file_t *file = NULL;
-    maze_t *maze_start = NULL, *maze_goal = NULL;
-    pthread_mutex_t *return_value_mutex = NULL;
-    a_star_return_t *return_value = NULL;
     size_t thread_num = (size_t) get_nprocs();
-    size_t *finished = NULL;
-    a_star_argument_t *argument_start = NULL, *argument_goal = NULL;
-    pthread_t from_start, from_goal;
-    node_t *node = NULL;
+    landmark_t *landmarks = NULL;
+    int landmark_num = 0, cluster = 0, weight = 0;
+    long timeout_ms = 0;
+    const char *edits = NULL, *target_name = NULL, *field = NULL, *out_name = NULL, *list = NULL;
+    const char *trace_name = NULL;
+    trace_file_t *trace = NULL;
+    int source_x = 1, source_y = 1, format = -1, connectivity = 4, large = 0;
+    path_t *path = NULL;
+    int opt, ret = 0;
 
+    while ((opt = getopt(argc, argv, "l:c:e:w:t:s:T:d:o:f:b:8Lr:")) != -1) {
+        switch (opt) {
+            case 'l':
+                landmark_num = atoi(optarg);
+                if (landmark_num <= 0 || landmark_num > LANDMARK_MAX) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'c':
+                cluster = atoi(optarg);
+                if (cluster <= 1) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'e':
+                edits = optarg;
+                break;
+            case 'w':
+                weight = (int) (atof(optarg) * WEIGHT_ONE + 0.5);
+                if (weight < WEIGHT_ONE) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 't':
+                timeout_ms = atol(optarg);
+                if (timeout_ms <= 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                if (weight == 0) weight = ANYTIME_WEIGHT;
+                break;
+            case 's':
+                if (sscanf(optarg, "%d,%d", &source_x, &source_y) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'T':
+                target_name = optarg;
+                break;
+            case 'd':
+                field = optarg;
+                break;
+            case 'o':
+                out_name = optarg;
+                break;
+            case 'f':
+                if (strcmp(optarg, "maze") == 0) format = OUTPUT_MAZE;
+                else if (strcmp(optarg, "rle") == 0) format = OUTPUT_RLE;
+                else if (strcmp(optarg, "dir") == 0) format = OUTPUT_DIR;
+                else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'b':
+                list = optarg;
+                break;
+            case '8':
+                connectivity = 8;
+                break;
+            case 'L':
+                large = 1;
+                break;
+            case 'r':
+                trace_name = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (thread_num == 0) thread_num = 1;
+    /* the other modes measure 4-connected steps. */
+    if (connectivity == 8 && (landmark_num > 0 || cluster > 0 || weight > 0 || edits != NULL ||
+                              target_name != NULL || field != NULL || list != NULL)) {
+        usage(argv[0]);
+        return 1;
+    }
+    /* the sparse kernel is the plain 4-connected one. */
+    if (large && (connectivity == 8 || landmark_num > 0 || cluster > 0 || edits != NULL ||
+                  target_name != NULL || field != NULL || list != NULL)) {
+        usage(argv[0]);
+        return 1;
+    }
+    /* only HDA* threads are traced. */
+    if (trace_name != NULL && (cluster > 0 || edits != NULL || list != NULL)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (list != NULL) {
+        FILE *in = optind == argc && strcmp(list, "-") == 0 ? stdin : fopen(list, "r");
+        if (optind != argc || in == NULL) {
+            if (in == NULL) fprintf(stderr, "cannot open %s\n", list);
+            else usage(argv[0]);
+            return 1;
+        }
+        ret = batch_search(in, thread_num, format);
+        if (in != stdin) fclose(in);
+        return ret;
+    }
+    /* compact formats never go back into the source. */
+    if (format < 0) format = OUTPUT_MAZE;
+    else if (format != OUTPUT_MAZE && out_name == NULL) out_name = "-";
     /* Must have given the source file name. */
-    assert(argc == 2);
+    if (optind + 1 != argc) {
+        usage(argv[0]);
+        return 1;
+    }
     /* Initializations. */
-    file = maze_file_init(argv[1]);
-    maze_start = maze_init(file->cols, file->rows, 1, 1, file->cols - 1, file->rows - 2);
-    maze_goal = maze_init(file->cols, file->rows, file->cols - 2, file->rows - 2, 0, 1);
-    return_value_mutex = malloc(sizeof(pthread_mutex_t));
-    pthread_mutex_init(return_value_mutex, NULL);
-    return_value = malloc(sizeof(a_star_return_t));
-    return_value->min_len = INT_MAX;
-    return_value->x = -1;
-    return_value->y = -1;
-    finished = malloc(sizeof(size_t));
-    *finished = 0;
-    argument_start = malloc(sizeof(a_star_argument_t));
-    argument_goal = malloc(sizeof(a_star_argument_t));
-    /* shared arguments-> */
-    argument_start->file = file;
-    argument_goal->file = file;
-    argument_start->other_maze = maze_goal;
-    argument_goal->other_maze = maze_start;
-    argument_start->maze = maze_start;
-    argument_goal->maze = maze_goal;
-    argument_start->return_value_mutex = return_value_mutex;
-    argument_goal->return_value_mutex = return_value_mutex;
-    argument_start->return_value = return_value;
-    argument_goal->return_value = return_value;
-    argument_start->thread_num = thread_num / 2;
-    argument_goal->thread_num = thread_num / 2;
-    argument_start->finished = finished;
-    argument_goal->finished = finished;
-
-    /* create two threads. */
-    assert(!pthread_create(&from_start, NULL, (void *(*)(void *)) a_star_search, argument_start));
-    assert(!pthread_create(&from_goal, NULL, (void *(*)(void *)) a_star_search, argument_goal));
-    /* join two threads thread. */
-    assert(!pthread_join(from_start, NULL));
-    assert(!pthread_join(from_goal, NULL));
-
-    /* Print the steps back. */
-    maze_lines(file, return_value->x, return_value->y) = '*';
-    for (node = maze_node(argument_start->maze, return_value->x, return_value->y)->parent;
-         node != NULL; node = node->parent)
-        maze_lines(file, node->x, node->y) = '*';
-    for (node = maze_node(argument_goal->maze, return_value->x, return_value->y)->parent;
-         node != NULL; node = node->parent)
-        maze_lines(file, node->x, node->y) = '*';
+    file = maze_file_init(argv[optind]);
+    if (file == NULL) {
+        fprintf(stderr, "cannot read maze %s\n", argv[optind]);
+        return 1;
+    }
+    if (cluster > 0) {
+        /* the abstract graph replaces the dense search state entirely. */
+        hpa_t *hpa = load_hpa(argv[optind], file, cluster, thread_num, 0);
+        int len;
+        path = path_init();
+        len = hpa_search(hpa, file, 1, 1, file->cols - 2, file->rows - 2, path);
+        if (len == HPA_DAMAGED) {
+            /* the cache is only checked where it is read: rebuild it. */
+            fprintf(stderr, "warning: rebuilding damaged hierarchical index\n");
+            hpa_destroy(hpa);
+            hpa = load_hpa(argv[optind], file, cluster, thread_num, 1);
+            len = hpa_search(hpa, file, 1, 1, file->cols - 2, file->rows - 2, path);
+        }
+        if (len >= 0) {
+            int in_place = out_name == NULL ||
+                           (format == OUTPUT_MAZE && strcmp(out_name, "-") != 0 && same_file(file, out_name));
+            char *cache = cache_name(argv[optind], ".hpa");
+            ret = write_path(path, file, argv[optind], out_name, format);
+            /* marking the path keeps the walls, so the index still holds. */
+            if (ret == 0 && in_place) hpa_rekey(file, cache);
+            free(cache);
+        } else {
+            ret = 1;
+        }
+        path_destroy(path);
+        hpa_destroy(hpa);
+        maze_file_destroy(file);
+        return ret;
+    }
+    if (edits != NULL) {
+        FILE *in = strcmp(edits, "-") == 0 ? stdin : fopen(edits, "r");
+        if (in == NULL) {
+            fprintf(stderr, "cannot open %s\n", edits);
+            maze_file_destroy(file);
+            return 1;
+        }
+        path = path_init();
+        replan_edits(file, in, path);
+        if (in != stdin) fclose(in);
+        /* the toggled walls stay in the private mapping, only the path is marked. */
+        ret = write_path(path, file, argv[optind], out_name, format);
+        path_destroy(path);
+        maze_file_destroy(file);
+        return ret;
+    }
+    if (target_name != NULL || field != NULL) {
+        targets_t *targets = NULL;
+        if (source_x <= 0 || source_y <= 0 || source_x >= file->cols - 1 ||
+            source_y >= file->rows - 1 || maze_lines(file, source_x, source_y) == '#') {
+            fprintf(stderr, "source %d %d is not an open cell\n", source_x, source_y);
+            maze_file_destroy(file);
+            return 1;
+        }
+        if (target_name != NULL) {
+            FILE *in = strcmp(target_name, "-") == 0 ? stdin : fopen(target_name, "r");
+            if (in == NULL) {
+                fprintf(stderr, "cannot open %s\n", target_name);
+                maze_file_destroy(file);
+                return 1;
+            }
+            targets = targets_read(in, file);
+            if (in != stdin) fclose(in);
+        }
+        if (trace_name != NULL && (trace = trace_file_init(trace_name, file->rows, file->cols)) == NULL)
+            ret = trace_fail(trace_name);
+        else
+            ret = one_to_many(file, source_x, source_y, targets, field, thread_num, trace);
+        if (trace != NULL && trace_file_destroy(trace) != 0) ret = trace_fail(trace_name);
+        if (targets != NULL) targets_destroy(targets);
+        maze_file_destroy(file);
+        return ret;
+    }
+    if (landmark_num > 0) {
+        landmarks = load_landmarks(argv[optind], file, landmark_num, thread_num);
+        compass_landmarks = landmarks;
+    }
+    if (connectivity == 4 && landmarks == NULL &&
+        (size_t) file->rows * file->cols >= MAZE_SPARSE_AREA)
+        large = 1;
+    /* only the cells around the search are read, so skip readahead. */
+    if (large) madvise(file->mem_map, file->mem_size, MADV_RANDOM);
+    path = path_init();
+    if (trace_name != NULL && (trace = trace_file_init(trace_name, file->rows, file->cols)) == NULL)
+        ret = trace_fail(trace_name);
+    else if (bidirectional_search(file, thread_num, connectivity, large, weight, timeout_ms, trace,
+                                  path) == 0)
+        ret = write_path(path, file, argv[optind], out_name, format);
+    else
+        ret = 1;
+    if (trace != NULL && trace_file_destroy(trace) != 0) ret = trace_fail(trace_name);
 
     /* Free resources and return. */
+    path_destroy(path);
     maze_file_destroy(file);
-    maze_destroy(maze_start);
-    maze_destroy(maze_goal);
-    free(return_value_mutex);
-    free(return_value);
-    free(finished);
-    free(argument_start);
-    free(argument_goal);
-    return 0;
+    if (landmarks != NULL) landmark_destroy(landmarks);
+    return ret;
 }
@@ -25,47 +25,112 @@
  */
 maze_t *maze_init(int cols, int rows, int start_x, int start_y, int goal_x, int goal_y) {
     maze_t *maze = malloc(sizeof(maze_t));
-    size_t size = rows * cols * sizeof(node_t *);
-    /* Allocate space for all nodes (cells) inside the maze. */
+    assert(maze != NULL);
+    /* Allocate space for all nodes (cells) inside the maze, zeroed lazily. */
     maze->cols = cols;
     maze->start_x = start_x;
     maze->start_y = start_y;
-    maze->nodes = malloc(size);
-    memset(maze->nodes, 0, size);
+    maze->nodes = calloc((size_t) rows * (size_t) cols, sizeof(node_t *));
+    assert(maze->nodes != NULL);
+    maze->tables = NULL;
+    maze->table_num = 0;
     /* initial special nodes. */
     node_init(&maze->goal, goal_x, goal_y);
     return maze;
 }
 
+/**
+ * Initialize a sparse maze, whose nodes are kept in TABLE_NUM segments of a
+ *   hash table, one per HDA* thread, instead of one pointer per cell.
+ *   Returns the pointer to the new maze.
+ */
+maze_t *maze_init_sparse(int cols, int start_x, int start_y, int goal_x, int goal_y,
+                         size_t table_num) {
+    maze_t *maze = malloc(sizeof(maze_t));
+    size_t i;
+    assert(maze != NULL);
+    maze->cols = cols;
+    maze->start_x = start_x;
+    maze->start_y = start_y;
+    maze->nodes = NULL;
+    maze->tables = malloc(table_num * sizeof(table_t));
+    assert(maze->tables != NULL);
+    maze->table_num = table_num;
+    for (i = 0; i < table_num; i++) table_init(&maze->tables[i]);
+    node_init(&maze->goal, goal_x, goal_y);
+    return maze;
+}
+
 /**
  * Delete the memory occupied by the maze M.
  */
 void maze_destroy(maze_t *maze) {
+    size_t i;
+    for (i = 0; i < maze->table_num; i++) table_destroy(&maze->tables[i]);
+    free(maze->tables);
     free(maze->nodes);
     free(maze);
 }
 
+/**
+ * Width of the rows of a maze of ROWS rows of COLS cells starting at BEGIN,
+ *   line ending included, if the first and the last rows are that far
+ *   apart; 0 if not. Rows can then be placed without reading them, so a
+ *   large maze is only paged in where it is searched.
+ */
+static size_t maze_file_width(const char *begin, const char *end, int rows, int cols) {
+    const char *eol, *last;
+    size_t width;
+    if (end - begin <= cols) return 0;
+    eol = memchr(begin + cols, '\n', (size_t) (end - begin - cols));
+    if (eol == NULL) return 0;
+    width = (size_t) (eol - begin) + 1;
+    if ((size_t) (end - begin) < (size_t) (rows - 1) * width + cols) return 0;
+    last = begin + (size_t) (rows - 1) * width;
+    return last[-1] == '\n' ? width : 0;
+}
+
+/**
+ * Map the maze source file FILENAME. It is opened read-only and mapped
+ *   copy-on-write: walling the entrances only copies the pages holding them,
+ *   and nothing ever reaches the source. Returns the pointer to the file,
+ *   NULL if it cannot be read or is not a maze.
+ */
 maze_file_t *maze_file_init(char *filename) {
-    char *file_ptr;
+    char *file_ptr, *file_end, *first;
+    size_t width;
     struct stat status;
     int rows, cols;
     int i;
     maze_file_t *file = malloc(sizeof(maze_file_t));
+    assert(file != NULL);
     /* Open the source file and read in number of rows & cols. */
-    file->fd = open(filename, O_RDWR);
-    assert(file->fd != -1);
-    assert(fstat(file->fd, &status) != -1);
+    file->fd = open(filename, O_RDONLY);
+    if (file->fd == -1) {
+        free(file);
+        return NULL;
+    }
+    if (fstat(file->fd, &status) == -1 || status.st_size == 0) {
+        close(file->fd);
+        free(file);
+        return NULL;
+    }
     file->mem_size = (size_t) status.st_size;
     file->mem_map = mmap(
             NULL,
             (size_t) status.st_size,
             PROT_READ | PROT_WRITE,
-            MAP_SHARED,
+            MAP_PRIVATE,
             file->fd, 0);
     assert(file->mem_map != MAP_FAILED);
 
     /* at maze_print_step.*/
-    assert(sscanf((char *) file->mem_map, "%d %d\n", &rows, &cols) == 2);
+    if (sscanf((char *) file->mem_map, "%d %d\n", &rows, &cols) != 2 || rows < 3 || cols < 3) {
+        munmap(file->mem_map, file->mem_size);
+        close(file->fd);
+        free(file);
+        return NULL;
+    }
     file->cols = cols;
     file->rows = rows;
 
@@ -75,8 +140,19 @@ maze_file_t *maze_file_init(char *filename) {
     memset(file->lines, 0, rows * sizeof(char *));
 
     file_ptr = file->mem_map;
+    file_end = file_ptr + file->mem_size;
+    /* skip the header line. */
+    while (file_ptr < file_end && *(file_ptr++) != '\n');
+    first = file_ptr;
+    width = maze_file_width(first, file_end, rows, cols);
     for (i = 0; i < rows; i++) {
-        while (*(file_ptr++) != '\n');
+        if (width != 0) file_ptr = first + (size_t) i * width;
+        else if (i > 0) while (file_ptr < file_end && *(file_ptr++) != '\n');
+        if (file_end - file_ptr < file->cols) {
+            /* truncated. */
+            maze_file_destroy(file);
+            return NULL;
+        }
         file->lines[i] = file_ptr;
         file_ptr += file->cols;
     }
@@ -86,11 +162,21 @@ maze_file_t *maze_file_init(char *filename) {
     return file;
 }
 
+/**
+ * Hash of the cells of maze FILE (FNV-1a), line endings excluded. Caches
+ *   derived from a maze keep it to notice that the maze has changed.
+ */
+unsigned long maze_file_hash(const maze_file_t *file) {
+    unsigned long hash = 0xcbf29ce484222325UL;
+    int x, y;
+    for (y = 0; y < file->rows; y++)
+        for (x = 0; x < file->cols; x++)
+            hash = (hash ^ (unsigned char) maze_lines(file, x, y)) * 0x100000001b3UL;
+    return hash;
+}
+
 void maze_file_destroy(maze_file_t *file) {
-    maze_lines(file, 0, 1) = '@';
-    maze_lines(file, file->cols - 1, file->rows - 2) = '%';
     free(file->lines);
-    msync(file->mem_map, file->mem_size, MS_ASYNC | MS_INVALIDATE);
     munmap(file->mem_map, file->mem_size);
     close(file->fd);
     free(file);
@@ -14,17 +14,28 @@
 
 #include <stdio.h>  /* FILE */
 #include "node.h"
+#include "table.h"
 
-#define maze_node(maze, x, y)       ((maze)->nodes[(y) * (maze)->cols + (x)])
+#define maze_index(maze, x, y)      ((size_t) (y) * (size_t) (maze)->cols + (size_t) (x))
+#define maze_node(maze, x, y)       ((maze)->nodes[maze_index(maze, x, y)])
+#define maze_node_put(maze, x, y, node) (maze_node(maze, x, y) = (node))
+/* Sparse mazes: the segment of (X, Y) is the one of its HDA* owner thread. */
+#define maze_segment(maze, x, y)    (&(maze)->tables[((x) + (y)) % (maze)->table_num])
+#define maze_sparse_get(maze, x, y) table_get(maze_segment(maze, x, y), maze_index(maze, x, y))
+#define maze_sparse_put(maze, x, y, node) \
+    table_put(maze_segment(maze, x, y), maze_index(maze, x, y), node)
+#define maze_get(maze, x, y) \
+    ((maze)->nodes != NULL ? maze_node(maze, x, y) : maze_sparse_get(maze, x, y))
 #define maze_lines(file, x, y)      ((file)->lines[y][x])
 #define get_goal(maze)              (&((maze)->goal))
+#define maze_offset(file, x, y)     ((size_t) (&maze_lines(file, x, y) - (char *) (file)->mem_map))
 
 
 typedef struct maze_file_t {
     int rows;               /* Number of rows. */
     int cols;               /* Number of cols. */
     int fd;                 /* file descriptor. */
-    void *mem_map;          /* memory map. */
+    void *mem_map;          /* memory map, private to the process. */
     size_t mem_size;        /* memory map size. */
     char **lines;           /* lines pointer. */
 } maze_file_t;
@@ -33,7 +44,9 @@ typedef struct maze_file_t {
  * Structure of a minecraft-style block maze.
  */
 typedef struct maze_t {
-    node_t **nodes;         /* Array of node. */
+    node_t **nodes;         /* Array of node, NULL if sparse. */
+    table_t *tables;        /* Segments of a sparse maze, NULL if dense. */
+    size_t table_num;       /* Number of segments. */
     node_t goal;            /* Goal node. */
     int cols;               /* Number of cols. */
     int start_x;
@@ -43,10 +56,15 @@ typedef struct maze_t {
 /* Function prototypes. */
 maze_t *maze_init(int cols, int rows, int start_x, int start_y, int goal_x, int goal_y);
 
+maze_t *maze_init_sparse(int cols, int start_x, int start_y, int goal_x, int goal_y,
+                         size_t table_num);
+
 void maze_destroy(maze_t *maze);
 
 maze_file_t *maze_file_init(char *filename);
 
+unsigned long maze_file_hash(const maze_file_t *file);
+
 void maze_file_destroy(maze_file_t *file);
 
 #endif
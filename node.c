@@ -43,7 +43,7 @@ void mem_pool_init(mem_pool_t *pool) {
     pool->end_chunk = pool->start_chunk;
     pool->end_chunk_len = (node_t *) pool->end_chunk + 1;
     pool->end_chunk_cap = (node_t *) ((size_t) pool->end_chunk + NODE_MEM_MAP_SIZE) - 1;
-    *(void **) pool = NULL;
+    *(void **) pool->start_chunk = NULL;
 }
 
 node_t *alloc_node(mem_pool_t *mem_pool) {
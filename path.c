@@ -0,0 +1,200 @@
+/**
+ * File: path.c
+ *
+ *   Implementation of paths and their output formats. Direction codes are
+ *     'U', 'D', 'L' and 'R', and 'Q', 'E', 'Z' and 'C' for the up-left,
+ *     up-right, down-left and down-right diagonals of 8-connected paths,
+ *     one per step; the run-length format prefixes a code with its repeat
+ *     count. Both start with the first cell "X Y".
+ */
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>     /* malloc, realloc, free, qsort */
+#include <string.h>     /* memset */
+#include <assert.h>     /* assert */
+#include <fcntl.h>      /* open */
+#include <unistd.h>     /* pwrite, close */
+#include "path.h"
+
+#define PATH_INIT_CAPACITY  (0x400)
+#define PATH_RUN_MAX        (0x1000)
+
+/**
+ * Cell of the source replaced by a byte on output.
+ */
+typedef struct path_overlay_t {
+    size_t offset;          /* Offset in the source. */
+    char c;                 /* Byte written instead. */
+} path_overlay_t;
+
+/**
+ * Initialize an empty path. Returns the pointer to the new path.
+ */
+path_t *path_init(void) {
+    path_t *path = malloc(sizeof(path_t));
+    assert(path != NULL);
+    path->len = 0;
+    path->capacity = PATH_INIT_CAPACITY;
+    path->xs = malloc(path->capacity * sizeof(int));
+    path->ys = malloc(path->capacity * sizeof(int));
+    assert(path->xs != NULL && path->ys != NULL);
+    return path;
+}
+
+/**
+ * Append cell (X, Y) to PATH.
+ */
+void path_push(path_t *path, int x, int y) {
+    if (path->len == path->capacity) {
+        path->capacity *= 2;
+        path->xs = realloc(path->xs, path->capacity * sizeof(int));
+        path->ys = realloc(path->ys, path->capacity * sizeof(int));
+        assert(path->xs != NULL && path->ys != NULL);
+    }
+    path->xs[path->len] = x;
+    path->ys[path->len] = y;
+    path->len++;
+}
+
+/**
+ * Reverse PATH in place, for searches that walk back from the goal.
+ */
+void path_reverse(path_t *path) {
+    int i, j;
+    for (i = 0, j = path->len - 1; i < j; i++, j--) {
+        int x = path->xs[i], y = path->ys[i];
+        path->xs[i] = path->xs[j];
+        path->ys[i] = path->ys[j];
+        path->xs[j] = x;
+        path->ys[j] = y;
+    }
+}
+
+/**
+ * Direction code of step I of PATH, from cell I to cell I + 1.
+ */
+static char path_step(const path_t *path, int i) {
+    static const char codes[3][3] = {{'Q', 'U', 'E'}, {'L', '?', 'R'}, {'Z', 'D', 'C'}};
+    int dx = path->xs[i + 1] - path->xs[i], dy = path->ys[i + 1] - path->ys[i];
+    return codes[dy + 1][dx + 1];
+}
+
+/**
+ * Write PATH to OUT as its first cell and one direction code per step.
+ *   Returns 0 on success, -1 on failure.
+ */
+int path_write_dir(const path_t *path, FILE *out) {
+    int i;
+    if (path->len == 0) return 0;
+    fprintf(out, "%d %d\n", path->xs[0], path->ys[0]);
+    for (i = 0; i + 1 < path->len; i++) putc(path_step(path, i), out);
+    putc('\n', out);
+    return ferror(out) ? -1 : 0;
+}
+
+/**
+ * Write PATH to OUT as its first cell and runs of direction codes, each as
+ *   "<count><code>". Returns 0 on success, -1 on failure.
+ */
+int path_write_rle(const path_t *path, FILE *out) {
+    int i, run = 0;
+    if (path->len == 0) return 0;
+    fprintf(out, "%d %d\n", path->xs[0], path->ys[0]);
+    for (i = 0; i + 1 < path->len; i++) {
+        run++;
+        if (i + 2 == path->len || path_step(path, i + 1) != path_step(path, i)) {
+            fprintf(out, "%d%c", run, path_step(path, i));
+            run = 0;
+        }
+    }
+    putc('\n', out);
+    return ferror(out) ? -1 : 0;
+}
+
+static int path_overlay_less(const void *a, const void *b) {
+    size_t x = ((const path_overlay_t *) a)->offset, y = ((const path_overlay_t *) b)->offset;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Overlay of PATH on FILE: its cells as '*' and the entrances, which are
+ *   walled in the mapping, as the source has them. Sorted by offset, with
+ *   LEN set to its length. The caller frees it.
+ */
+static path_overlay_t *path_overlay(const path_t *path, const maze_file_t *file, int *len) {
+    path_overlay_t *overlay = malloc((path->len + 2) * sizeof(path_overlay_t));
+    int i;
+    assert(overlay != NULL);
+    for (i = 0; i < path->len; i++) {
+        overlay[i].offset = maze_offset(file, path->xs[i], path->ys[i]);
+        overlay[i].c = '*';
+    }
+    overlay[path->len].offset = maze_offset(file, 0, 1);
+    overlay[path->len].c = '@';
+    overlay[path->len + 1].offset = maze_offset(file, file->cols - 1, file->rows - 2);
+    overlay[path->len + 1].c = '%';
+    *len = path->len + 2;
+    qsort(overlay, *len, sizeof(path_overlay_t), path_overlay_less);
+    return overlay;
+}
+
+/**
+ * Stream a copy of the maze FILE with PATH marked to OUT, the legacy output.
+ *   The mapping is copied between the marked cells, so nothing is dirtied.
+ *   Returns 0 on success, -1 on failure.
+ */
+int path_write_maze(const path_t *path, const maze_file_t *file, FILE *out) {
+    const char *source = file->mem_map;
+    size_t done = 0;
+    int len, i, ok = 1;
+    path_overlay_t *overlay = path_overlay(path, file, &len);
+    for (i = 0; ok && i < len; i++) {
+        ok = fwrite(source + done, 1, overlay[i].offset - done, out) == overlay[i].offset - done &&
+             putc(overlay[i].c, out) != EOF;
+        done = overlay[i].offset + 1;
+    }
+    if (ok) ok = fwrite(source + done, 1, file->mem_size - done, out) == file->mem_size - done;
+    free(overlay);
+    return ok ? 0 : -1;
+}
+
+/**
+ * Mark PATH on the source FILENAME of FILE in place. Only the path cells are
+ *   written, adjacent ones coalesced, so the cost follows the path length.
+ *   Returns 0 on success, -1 on failure.
+ */
+int path_write_back(const path_t *path, const maze_file_t *file, const char *filename) {
+    char run[PATH_RUN_MAX];
+    int fd = open(filename, O_WRONLY), len, i, j, ok = 1;
+    path_overlay_t *overlay;
+    if (fd == -1) return -1;
+    memset(run, '*', sizeof(run));
+    overlay = path_overlay(path, file, &len);
+    for (i = 0; ok && i < len; i = j) {
+        size_t size;
+        if (overlay[i].c != '*') {
+            /* entrances are left as the source has them. */
+            j = i + 1;
+            continue;
+        }
+        for (j = i + 1; j < len && j - i < PATH_RUN_MAX && overlay[j].c == '*' &&
+                        overlay[j].offset == overlay[j - 1].offset + 1; j++);
+        size = (size_t) (j - i);
+        ok = pwrite(fd, run, size, (off_t) overlay[i].offset) == (ssize_t) size;
+    }
+    free(overlay);
+    if (close(fd) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+/**
+ * Delete the memory occupied by PATH.
+ */
+void path_destroy(path_t *path) {
+    free(path->xs);
+    free(path->ys);
+    free(path);
+}
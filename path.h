@@ -0,0 +1,43 @@
+/**
+ * File: path.h
+ *
+ *   Declaration of a path, the list of cells from start to goal, and of its
+ *     output formats. The maze source is mapped privately, so a path never
+ *     reaches the source file unless written back explicitly.
+ */
+
+#ifndef _PATH_H_
+#define _PATH_H_
+
+#include <stdio.h>      /* FILE */
+#include "maze.h"
+
+
+/**
+ * Structure of a path, cells in order from start to goal.
+ */
+typedef struct path_t {
+    int *xs;                /* X coordinates. */
+    int *ys;                /* Y coordinates. */
+    int len;                /* Number of cells. */
+    int capacity;
+} path_t;
+
+/* Function prototypes. */
+path_t *path_init(void);
+
+void path_push(path_t *path, int x, int y);
+
+void path_reverse(path_t *path);
+
+int path_write_dir(const path_t *path, FILE *out);
+
+int path_write_rle(const path_t *path, FILE *out);
+
+int path_write_maze(const path_t *path, const maze_file_t *file, FILE *out);
+
+int path_write_back(const path_t *path, const maze_file_t *file, const char *filename);
+
+void path_destroy(path_t *path);
+
+#endif
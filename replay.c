@@ -0,0 +1,475 @@
+/**
+ * File: replay.c
+ *
+ *   Offline replay of a search trace recorded by "astar -r". The chunks of
+ *     every thread are joined back into one event stream per thread, from
+ *     which it reports the growth of the frontier, a utilisation timeline
+ *     per thread, the distribution of message latencies and the
+ *     re-expansions wasted on cells expanded more than once. The busy and
+ *     idle spans and the frontier can also be exported as Chrome trace JSON,
+ *     for chrome://tracing or Perfetto.
+ */
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdio.h>      /* printf, fprintf, fopen */
+#include <stdlib.h>     /* malloc, realloc, free, qsort, atoi */
+#include <string.h>     /* memset */
+#include <assert.h>     /* assert */
+#include <unistd.h>     /* getopt */
+#include "trace.h"
+
+#define REPLAY_INTERVALS        (20)
+#define REPLAY_LATENCY_BUCKETS  (32)    /* Powers of two of nanoseconds. */
+#define REPLAY_BAR              (40)
+
+#define replay_ms(ns)           ((double) (ns) / 1e6)
+#define replay_us(ns)           ((double) (ns) / 1e3)
+
+
+/**
+ * Events of one thread, in recording order, and what they add up to.
+ */
+typedef struct replay_thread_t {
+    int direction;
+    int thread_id;
+    trace_event_t *events;
+    size_t len;
+    size_t capacity;
+    size_t counts[TRACE_EVENT_NUM];     /* Number of events of each kind. */
+    size_t reexpanded;                  /* Expansions of a cell expanded before. */
+    unsigned long busy_ns;
+    unsigned long idle_ns;
+} replay_thread_t;
+
+typedef struct replay_t {
+    int rows;
+    int cols;
+    replay_thread_t *threads;           /* Ordered by direction, then id. */
+    int thread_num;
+    int thread_cap;
+    unsigned long begin;                /* Time of the first event. */
+    unsigned long end;                  /* Time of the last event. */
+} replay_t;
+
+static int replay_compare_thread(const void *a, const void *b) {
+    const replay_thread_t *t1 = a, *t2 = b;
+    if (t1->direction != t2->direction) return t1->direction < t2->direction ? -1 : 1;
+    return t1->thread_id < t2->thread_id ? -1 : t1->thread_id > t2->thread_id;
+}
+
+static int replay_compare_ulong(const void *a, const void *b) {
+    unsigned long u1 = *(const unsigned long *) a, u2 = *(const unsigned long *) b;
+    return u1 < u2 ? -1 : u1 > u2;
+}
+
+static const char *replay_direction(int direction) {
+    return direction == 0 ? "start" : "goal";
+}
+
+/**
+ * Thread THREAD_ID of DIRECTION in REPLAY, added if not seen yet.
+ */
+static replay_thread_t *replay_thread(replay_t *replay, int direction, int thread_id) {
+    replay_thread_t *thread;
+    int i;
+    for (i = 0; i < replay->thread_num; i++)
+        if (replay->threads[i].direction == direction && replay->threads[i].thread_id == thread_id)
+            return &replay->threads[i];
+    if (replay->thread_num == replay->thread_cap) {
+        replay->thread_cap *= 2;
+        replay->threads = realloc(replay->threads, replay->thread_cap * sizeof(replay_thread_t));
+        assert(replay->threads != NULL);
+    }
+    thread = &replay->threads[replay->thread_num++];
+    memset(thread, 0, sizeof(replay_thread_t));
+    thread->direction = direction;
+    thread->thread_id = thread_id;
+    return thread;
+}
+
+static void replay_destroy(replay_t *replay) {
+    int i;
+    for (i = 0; i < replay->thread_num; i++) free(replay->threads[i].events);
+    free(replay->threads);
+    free(replay);
+}
+
+/**
+ * Read the trace FILENAME. Returns the pointer to the replay, NULL if it
+ *   cannot be read or is not a trace.
+ */
+static replay_t *replay_load(const char *filename) {
+    FILE *in = fopen(filename, "rb");
+    replay_t *replay;
+    int header[3], i, damaged = 0;
+    size_t j;
+    if (in == NULL) return NULL;
+    if (fread(header, sizeof(int), 3, in) != 3 || header[0] != TRACE_MAGIC) {
+        fclose(in);
+        return NULL;
+    }
+    replay = malloc(sizeof(replay_t));
+    assert(replay != NULL);
+    replay->rows = header[1];
+    replay->cols = header[2];
+    replay->thread_num = 0;
+    replay->thread_cap = 8;
+    replay->threads = malloc(replay->thread_cap * sizeof(replay_thread_t));
+    assert(replay->threads != NULL);
+    while (1) {
+        replay_thread_t *thread;
+        size_t len, got = fread(header, sizeof(int), 3, in);
+        if (got == 0 && feof(in)) break;
+        if (got != 3 || header[0] < 0 || header[0] > 1 || header[1] < 0 || header[2] < 0) {
+            damaged = 1;
+            break;
+        }
+        len = (size_t) header[2];
+        thread = replay_thread(replay, header[0], header[1]);
+        if (thread->len + len > thread->capacity) {
+            thread->capacity = 2 * (thread->len + len);
+            thread->events = realloc(thread->events, thread->capacity * sizeof(trace_event_t));
+            assert(thread->events != NULL);
+        }
+        if (fread(thread->events + thread->len, sizeof(trace_event_t), len, in) != len) {
+            damaged = 1;
+            break;
+        }
+        thread->len += len;
+    }
+    if (damaged) {
+        fclose(in);
+        replay_destroy(replay);
+        return NULL;
+    }
+    fclose(in);
+    qsort(replay->threads, (size_t) replay->thread_num, sizeof(replay_thread_t),
+          replay_compare_thread);
+    replay->begin = (unsigned long) -1;
+    replay->end = 0;
+    for (i = 0; i < replay->thread_num; i++) {
+        replay_thread_t *thread = &replay->threads[i];
+        for (j = 0; j < thread->len; j++)
+            if (thread->events[j].event >= 0 && thread->events[j].event < TRACE_EVENT_NUM)
+                thread->counts[thread->events[j].event]++;
+        if (thread->len == 0) continue;
+        if (thread->events[0].ns < replay->begin) replay->begin = thread->events[0].ns;
+        if (thread->events[thread->len - 1].ns > replay->end)
+            replay->end = thread->events[thread->len - 1].ns;
+    }
+    if (replay->end < replay->begin) replay->begin = replay->end = 0;
+    return replay;
+}
+
+/**
+ * Next span of THREAD from event *I on, a thread being busy from a begin or
+ *   busy event and idle from an idle event until the next of these or an
+ *   end. Sets *FROM, *TO and *BUSY and returns 1, or returns 0 past the last
+ *   span.
+ */
+static int replay_span(const replay_thread_t *thread, size_t *i, unsigned long *from,
+                       unsigned long *to, int *busy) {
+    while (*i < thread->len) {
+        const trace_event_t *e = &thread->events[(*i)++];
+        if (e->event != TRACE_BEGIN && e->event != TRACE_BUSY && e->event != TRACE_IDLE) continue;
+        *from = e->ns;
+        *busy = e->event != TRACE_IDLE;
+        while (*i < thread->len && thread->events[*i].event != TRACE_BEGIN &&
+               thread->events[*i].event != TRACE_END && thread->events[*i].event != TRACE_BUSY &&
+               thread->events[*i].event != TRACE_IDLE)
+            (*i)++;
+        *to = *i < thread->len ? thread->events[*i].ns : thread->events[thread->len - 1].ns;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Interval of INTERVALS equal ones over the trace holding time NS.
+ */
+static int replay_interval(const replay_t *replay, unsigned long ns, int intervals) {
+    unsigned long width = replay->end - replay->begin;
+    int k;
+    if (width == 0) return 0;
+    k = (int) ((double) (ns - replay->begin) * intervals / (double) width);
+    return k < intervals ? k : intervals - 1;
+}
+
+/**
+ * Add the busy time of THREAD in each of INTERVALS equal intervals to BUSY,
+ *   and the time it ran at all to RUNNING.
+ */
+static void replay_utilisation(const replay_t *replay, const replay_thread_t *thread,
+                               int intervals, double *busy, double *running) {
+    double width = (double) (replay->end - replay->begin) / intervals;
+    unsigned long from, to;
+    size_t i = 0;
+    int is_busy, k;
+    if (width <= 0) return;
+    while (replay_span(thread, &i, &from, &to, &is_busy)) {
+        for (k = replay_interval(replay, from, intervals); k < intervals; k++) {
+            double lo = replay->begin + k * width, hi = lo + width, overlap;
+            if (lo >= (double) to) break;
+            overlap = ((double) to < hi ? (double) to : hi) - ((double) from > lo ? (double) from : lo);
+            if (overlap <= 0) continue;
+            running[k] += overlap;
+            if (is_busy) busy[k] += overlap;
+        }
+    }
+}
+
+/**
+ * Count the wasted re-expansions of THREAD. A cell has a single owner per
+ *   direction, so they are found within the thread.
+ */
+static void replay_reexpanded(const replay_t *replay, replay_thread_t *thread) {
+    unsigned long *cells = malloc((thread->counts[TRACE_EXPAND] + 1) * sizeof(unsigned long));
+    size_t i, len = 0;
+    assert(cells != NULL);
+    for (i = 0; i < thread->len; i++)
+        if (thread->events[i].event == TRACE_EXPAND)
+            cells[len++] = (unsigned long) thread->events[i].y * replay->cols + thread->events[i].x;
+    qsort(cells, len, sizeof(unsigned long), replay_compare_ulong);
+    thread->reexpanded = 0;
+    for (i = 1; i < len; i++)
+        if (cells[i] == cells[i - 1]) thread->reexpanded++;
+    free(cells);
+}
+
+static void replay_threads(const replay_t *replay) {
+    replay_thread_t total;
+    unsigned long duration = replay->end - replay->begin;
+    int i;
+    memset(&total, 0, sizeof(replay_thread_t));
+    printf("thread    expanded  re-exp.       sent   received    busy ms    idle ms   util\n");
+    for (i = 0; i <= replay->thread_num; i++) {
+        const replay_thread_t *thread = i < replay->thread_num ? &replay->threads[i] : &total;
+        if (i < replay->thread_num) {
+            printf("%-5s %3d", replay_direction(thread->direction), thread->thread_id);
+            total.counts[TRACE_EXPAND] += thread->counts[TRACE_EXPAND];
+            total.counts[TRACE_SEND] += thread->counts[TRACE_SEND];
+            total.counts[TRACE_RECEIVE] += thread->counts[TRACE_RECEIVE];
+            total.reexpanded += thread->reexpanded;
+            total.busy_ns += thread->busy_ns;
+            total.idle_ns += thread->idle_ns;
+        } else {
+            printf("total    ");
+        }
+        printf(" %9lu %8lu %10lu %10lu %10.3f %10.3f %5.1f%%\n",
+               (unsigned long) thread->counts[TRACE_EXPAND], (unsigned long) thread->reexpanded,
+               (unsigned long) thread->counts[TRACE_SEND], (unsigned long) thread->counts[TRACE_RECEIVE],
+               replay_ms(thread->busy_ns), replay_ms(thread->idle_ns),
+               duration == 0 ? 0.0 : 100.0 * thread->busy_ns /
+                                     ((double) duration * (i < replay->thread_num ? 1 : replay->thread_num)));
+    }
+    printf("wasted re-expansions: %lu of %lu expansions (%.1f%%)\n",
+           (unsigned long) total.reexpanded, (unsigned long) total.counts[TRACE_EXPAND],
+           total.counts[TRACE_EXPAND] == 0 ? 0.0 : 100.0 * total.reexpanded / total.counts[TRACE_EXPAND]);
+}
+
+/**
+ * Sum the open nodes of all threads at the end of each of INTERVALS into
+ *   OPEN, and the expansions within each into EXPANDED.
+ */
+static void replay_frontier(const replay_t *replay, int intervals, long *open, long *expanded) {
+    int *last = malloc(intervals * sizeof(int)), i, k;
+    size_t j;
+    assert(last != NULL);
+    for (k = 0; k < intervals; k++) open[k] = expanded[k] = 0;
+    for (i = 0; i < replay->thread_num; i++) {
+        const replay_thread_t *thread = &replay->threads[i];
+        for (k = 0; k < intervals; k++) last[k] = -1;
+        for (j = 0; j < thread->len; j++) {
+            k = replay_interval(replay, thread->events[j].ns, intervals);
+            last[k] = thread->events[j].open;
+            if (thread->events[j].event == TRACE_EXPAND) expanded[k]++;
+        }
+        /* an interval without events keeps the open nodes of the last. */
+        for (k = 0; k < intervals; k++) {
+            if (last[k] < 0) last[k] = k > 0 ? last[k - 1] : 0;
+            open[k] += last[k];
+        }
+    }
+    free(last);
+}
+
+static void replay_timeline(const replay_t *replay, int intervals) {
+    long *open = malloc(intervals * sizeof(long)), *expanded = malloc(intervals * sizeof(long));
+    double *busy = malloc(intervals * sizeof(double)), *running = malloc(intervals * sizeof(double));
+    double width = (double) (replay->end - replay->begin) / intervals;
+    int i, k;
+    assert(open != NULL && expanded != NULL && busy != NULL && running != NULL);
+    replay_frontier(replay, intervals, open, expanded);
+    printf("\nfrontier:\n       until ms       open   expanded\n");
+    for (k = 0; k < intervals; k++)
+        printf("%15.3f %10ld %10ld\n", replay_ms((k + 1) * width), open[k], expanded[k]);
+
+    printf("\nutilisation per interval (busy tenths, . idle, blank not running):\n");
+    for (i = 0; i < replay->thread_num; i++) {
+        const replay_thread_t *thread = &replay->threads[i];
+        for (k = 0; k < intervals; k++) busy[k] = running[k] = 0;
+        replay_utilisation(replay, thread, intervals, busy, running);
+        printf("%-5s %3d |", replay_direction(thread->direction), thread->thread_id);
+        for (k = 0; k < intervals; k++) {
+            int tenths = width <= 0 ? 0 : (int) (busy[k] * 10 / width);
+            if (running[k] <= 0) putchar(' ');
+            else if (tenths == 0) putchar('.');
+            else putchar('0' + (tenths > 9 ? 9 : tenths));
+        }
+        printf("|\n");
+    }
+    free(open);
+    free(expanded);
+    free(busy);
+    free(running);
+}
+
+static void replay_latency(const replay_t *replay) {
+    size_t num = 0, i, j, histogram[REPLAY_LATENCY_BUCKETS], peak = 0;
+    unsigned long *latencies;
+    int b, first = REPLAY_LATENCY_BUCKETS, last = -1;
+    for (i = 0; i < (size_t) replay->thread_num; i++) num += replay->threads[i].counts[TRACE_RECEIVE];
+    printf("\nmessage latency: %lu messages", (unsigned long) num);
+    if (num == 0) {
+        printf("\n");
+        return;
+    }
+    latencies = malloc(num * sizeof(unsigned long));
+    assert(latencies != NULL);
+    num = 0;
+    for (i = 0; i < (size_t) replay->thread_num; i++)
+        for (j = 0; j < replay->threads[i].len; j++)
+            if (replay->threads[i].events[j].event == TRACE_RECEIVE)
+                latencies[num++] = (unsigned long) replay->threads[i].events[j].fs;
+    qsort(latencies, num, sizeof(unsigned long), replay_compare_ulong);
+    printf(", min %lu, median %lu, p90 %lu, p99 %lu, max %lu ns\n", latencies[0],
+           latencies[num / 2], latencies[num * 9 / 10], latencies[num * 99 / 100], latencies[num - 1]);
+    for (b = 0; b < REPLAY_LATENCY_BUCKETS; b++) histogram[b] = 0;
+    for (i = 0; i < num; i++) {
+        /* bucket B holds latencies below 2^B ns. */
+        for (b = 0; b < REPLAY_LATENCY_BUCKETS - 1 && latencies[i] >= 1UL << b; b++);
+        histogram[b]++;
+    }
+    for (b = 0; b < REPLAY_LATENCY_BUCKETS; b++) {
+        if (histogram[b] == 0) continue;
+        if (b < first) first = b;
+        last = b;
+        if (histogram[b] > peak) peak = histogram[b];
+    }
+    printf("       below ns   messages\n");
+    for (b = first; b <= last; b++) {
+        int bar = (int) (histogram[b] * REPLAY_BAR / peak);
+        printf("%15lu %10lu ", 1UL << b, (unsigned long) histogram[b]);
+        while (bar-- > 0) putchar('#');
+        putchar('\n');
+    }
+    free(latencies);
+}
+
+/**
+ * Export the spans of every thread and the frontier over INTERVALS to the
+ *   Chrome trace JSON file FILENAME. Returns 0 on success.
+ */
+static int replay_json(const replay_t *replay, const char *filename, int intervals) {
+    FILE *out = fopen(filename, "w");
+    long *open = malloc(intervals * sizeof(long)), *expanded = malloc(intervals * sizeof(long));
+    double width = (double) (replay->end - replay->begin) / intervals;
+    int i, k, ok;
+    if (out == NULL) {
+        free(open);
+        free(expanded);
+        return -1;
+    }
+    assert(open != NULL && expanded != NULL);
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (i = 0; i < replay->thread_num; i++) {
+        const replay_thread_t *thread = &replay->threads[i];
+        unsigned long from, to;
+        size_t j = 0;
+        int busy;
+        fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                     "\"args\":{\"name\":\"%s %d\"}},\n",
+                i, replay_direction(thread->direction), thread->thread_id);
+        while (replay_span(thread, &j, &from, &to, &busy))
+            fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},\n",
+                    busy ? "busy" : "idle", i, replay_us(from - replay->begin), replay_us(to - from));
+    }
+    replay_frontier(replay, intervals, open, expanded);
+    for (k = 0; k < intervals; k++)
+        fprintf(out, "{\"name\":\"frontier\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,"
+                     "\"args\":{\"open\":%ld,\"expanded\":%ld}}%s\n",
+                replay_us(k * width), open[k], expanded[k], k + 1 < intervals ? "," : "");
+    fprintf(out, "]}\n");
+    ok = !ferror(out);
+    if (fclose(out) != 0) ok = 0;
+    free(open);
+    free(expanded);
+    return ok ? 0 : -1;
+}
+
+void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n intervals] [-j json] trace\n", name);
+    fprintf(stderr, "  -n intervals  split the timelines into this many intervals (default %d)\n",
+            REPLAY_INTERVALS);
+    fprintf(stderr, "  -j json       also export the thread spans and the frontier as Chrome\n"
+                    "                trace JSON to json\n");
+}
+
+int main(int argc, char *argv[]) {
+    replay_t *replay;
+    const char *json = NULL;
+    int intervals = REPLAY_INTERVALS, opt, i, ret = 0;
+
+    while ((opt = getopt(argc, argv, "n:j:")) != -1) {
+        switch (opt) {
+            case 'n':
+                intervals = atoi(optarg);
+                if (intervals <= 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'j':
+                json = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind + 1 != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    replay = replay_load(argv[optind]);
+    if (replay == NULL) {
+        fprintf(stderr, "cannot read trace %s\n", argv[optind]);
+        return 1;
+    }
+
+    for (i = 0; i < replay->thread_num; i++) {
+        replay_thread_t *thread = &replay->threads[i];
+        unsigned long from, to;
+        size_t j = 0;
+        int busy;
+        while (replay_span(thread, &j, &from, &to, &busy)) {
+            if (busy) thread->busy_ns += to - from;
+            else thread->idle_ns += to - from;
+        }
+        replay_reexpanded(replay, thread);
+    }
+    printf("trace %s: %d x %d maze, %d threads, %.3f ms\n", argv[optind], replay->rows, replay->cols,
+           replay->thread_num, replay_ms(replay->end - replay->begin));
+    replay_threads(replay);
+    replay_timeline(replay, intervals);
+    replay_latency(replay);
+    if (json != NULL && replay_json(replay, json, intervals) != 0) {
+        fprintf(stderr, "cannot write %s\n", json);
+        ret = 1;
+    }
+    replay_destroy(replay);
+    return ret;
+}
@@ -0,0 +1,78 @@
+/**
+ * File: serial.c
+ *
+ *   Implementation of the single-threaded A* search with the manhattan
+ *     heuristic. Nodes live in one dense array indexed by cell, initialized
+ *     lazily, so a search only touches the pages of the cells it reaches.
+ */
+
+#include <stdlib.h>     /* abs, malloc, calloc, free */
+#include <assert.h>     /* assert */
+#include "serial.h"
+#include "heap.h"
+#include "node.h"
+
+/**
+ * Search a shortest path from (START_X, START_Y) to (GOAL_X, GOAL_Y) on FILE
+ *   into PATH. Returns the number of cells on the path, -1 if there is none.
+ */
+int serial_search(const maze_file_t *file, int start_x, int start_y, int goal_x, int goal_y,
+                  path_t *path) {
+    size_t size = (size_t) file->rows * file->cols;
+    node_t *nodes = malloc(size * sizeof(node_t));
+    unsigned char *seen = calloc(size, 1);
+    node_t *node, *goal = NULL;
+    heap_t heap;
+    int len = -1;
+    assert(nodes != NULL && seen != NULL);
+
+    heap_init(&heap);
+    node = node_init(&nodes[(size_t) start_y * file->cols + start_x], start_x, start_y);
+    seen[(size_t) start_y * file->cols + start_x] = 1;
+    node->gs = 1;
+    node->fs = 1 + abs(start_x - goal_x) + abs(start_y - goal_y);
+    heap_insert(&heap, node);
+
+    while (heap.size > 1) {
+        int x_axis[4], y_axis[4], i;
+        node = heap_extract(&heap);
+        if (node->x == goal_x && node->y == goal_y) {
+            goal = node;
+            break;
+        }
+        x_axis[0] = node->x + 1;
+        y_axis[0] = node->y;
+        x_axis[1] = node->x - 1;
+        y_axis[1] = node->y;
+        x_axis[2] = node->x;
+        y_axis[2] = node->y + 1;
+        x_axis[3] = node->x;
+        y_axis[3] = node->y - 1;
+        for (i = 0; i < 4; i++) {
+            size_t id = (size_t) y_axis[i] * file->cols + x_axis[i];
+            node_t *adj = &nodes[id];
+            if (maze_lines(file, x_axis[i], y_axis[i]) == '#') continue;
+            if (!seen[id]) {
+                seen[id] = 1;
+                node_init(adj, x_axis[i], y_axis[i]);
+            }
+            if (node->gs + 1 < adj->gs) {
+                adj->parent = node;
+                adj->gs = node->gs + 1;
+                adj->fs = adj->gs + abs(adj->x - goal_x) + abs(adj->y - goal_y);
+                if (adj->heap_id != 0) heap_update(&heap, adj);
+                else heap_insert(&heap, adj);
+            }
+        }
+    }
+
+    if (goal != NULL) {
+        len = goal->gs;
+        for (node = goal; node != NULL; node = node->parent) path_push(path, node->x, node->y);
+        path_reverse(path);
+    }
+    heap_destroy(&heap);
+    free(nodes);
+    free(seen);
+    return len;
+}
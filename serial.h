@@ -0,0 +1,19 @@
+/**
+ * File: serial.h
+ *
+ *   Declaration of the single-threaded A* search, for mazes too small to pay
+ *     for HDA* threads and message queues. Several of them can run side by
+ *     side in the batch scheduler.
+ */
+
+#ifndef _SERIAL_H_
+#define _SERIAL_H_
+
+#include "maze.h"
+#include "path.h"
+
+/* Function prototypes. */
+int serial_search(const maze_file_t *file, int start_x, int start_y, int goal_x, int goal_y,
+                  path_t *path);
+
+#endif
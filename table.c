@@ -0,0 +1,90 @@
+/**
+ * File: table.c
+ *
+ *   Implementation of the sparse cell table. Slots are probed linearly from
+ *     a multiplicative hash. The owner of a segment stores the value before
+ *     releasing the key, so a reader that acquires a key sees its node.
+ */
+
+#include <stdlib.h>     /* malloc, calloc, free */
+#include <assert.h>     /* assert */
+#include "table.h"
+
+#define table_hash(key, capacity) \
+    ((size_t) (((unsigned long) (key) * 0x9e3779b97f4a7c15UL) >> 17) & ((capacity) - 1))
+
+static table_slots_t *table_slots_init(size_t capacity, table_slots_t *prev) {
+    table_slots_t *slots = malloc(sizeof(table_slots_t));
+    assert(slots != NULL);
+    slots->capacity = capacity;
+    slots->keys = calloc(capacity, sizeof(size_t));
+    slots->values = malloc(capacity * sizeof(node_t *));
+    assert(slots->keys != NULL && slots->values != NULL);
+    slots->prev = prev;
+    return slots;
+}
+
+/**
+ * Store KEY and NODE in a free slot of SLOTS, or over the slot of KEY.
+ */
+static void table_slots_put(table_slots_t *slots, size_t key, node_t *node) {
+    size_t i = table_hash(key, slots->capacity);
+    while (slots->keys[i] != 0 && slots->keys[i] != key) i = (i + 1) & (slots->capacity - 1);
+    slots->values[i] = node;
+    __atomic_store_n(&slots->keys[i], key, __ATOMIC_RELEASE);
+}
+
+/**
+ * Initialize an empty segment TABLE.
+ */
+void table_init(table_t *table) {
+    table->slots = table_slots_init(TABLE_INIT_CAPACITY, NULL);
+    table->len = 0;
+}
+
+/**
+ * Look up the node of cell INDEX in TABLE. Returns NULL if there is none.
+ *   Safe against a concurrent owner.
+ */
+node_t *table_get(const table_t *table, size_t index) {
+    const table_slots_t *slots = __atomic_load_n(&table->slots, __ATOMIC_ACQUIRE);
+    size_t key = index + 1, i = table_hash(key, slots->capacity);
+    while (1) {
+        size_t found = __atomic_load_n(&slots->keys[i], __ATOMIC_ACQUIRE);
+        if (found == key) return slots->values[i];
+        if (found == 0) return NULL;
+        i = (i + 1) & (slots->capacity - 1);
+    }
+}
+
+/**
+ * Set the node of cell INDEX in TABLE to NODE. Only the owner of the segment
+ *   may call it. Grows the segment to keep it at most half full.
+ */
+void table_put(table_t *table, size_t index, node_t *node) {
+    table_slots_t *slots = table->slots;
+    if (2 * (table->len + 1) > slots->capacity) {
+        table_slots_t *grown = table_slots_init(2 * slots->capacity, slots);
+        size_t i;
+        for (i = 0; i < slots->capacity; i++)
+            if (slots->keys[i] != 0) table_slots_put(grown, slots->keys[i], slots->values[i]);
+        __atomic_store_n(&table->slots, grown, __ATOMIC_RELEASE);
+        slots = grown;
+    }
+    table_slots_put(slots, index + 1, node);
+    table->len++;
+}
+
+/**
+ * Delete the memory occupied by TABLE, every generation of it.
+ */
+void table_destroy(table_t *table) {
+    table_slots_t *slots = table->slots;
+    while (slots != NULL) {
+        table_slots_t *prev = slots->prev;
+        free(slots->keys);
+        free(slots->values);
+        free(slots);
+        slots = prev;
+    }
+}
@@ -0,0 +1,46 @@
+/**
+ * File: table.h
+ *
+ *   Declaration of the sparse cell table of the large-maze mode, mapping 64-
+ *     bit cell indices to nodes. It is open addressed and segmented: every
+ *     segment has a single writer, the HDA* thread owning its cells, while
+ *     any thread may look cells up concurrently without locks.
+ */
+
+#ifndef _TABLE_H_
+#define _TABLE_H_
+
+#include <stddef.h>     /* size_t */
+#include "node.h"
+
+#define TABLE_INIT_CAPACITY     (0x400)
+
+
+/**
+ * Generation of slots of a segment. Growing publishes a new generation and
+ *   keeps the old ones, which concurrent readers may still probe, until the
+ *   segment is destroyed.
+ */
+typedef struct table_slots_t {
+    size_t capacity;                /* Number of slots, a power of two. */
+    size_t *keys;                   /* Cell index + 1, 0 if empty. */
+    node_t **values;
+    struct table_slots_t *prev;     /* Previous generation. */
+} table_slots_t;
+
+typedef struct table_t {
+    table_slots_t *slots;           /* Current generation. */
+    size_t len;                     /* Number of cells, written by the owner. */
+    void *padding[6];               /* Segments of threads on own lines. */
+} table_t;
+
+/* Function prototypes. */
+void table_init(table_t *table);
+
+node_t *table_get(const table_t *table, size_t index);
+
+void table_put(table_t *table, size_t index, node_t *node);
+
+void table_destroy(table_t *table);
+
+#endif
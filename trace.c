@@ -0,0 +1,122 @@
+/**
+ * File: trace.c
+ *
+ *   Implementation of the search trace recorder. Recording an event is a
+ *     clock read and a store into the buffer of the thread; only flushing a
+ *     full buffer takes the file lock.
+ */
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>     /* malloc, free */
+#include <assert.h>     /* assert */
+#include "trace.h"
+
+/**
+ * Append the buffered events of TRACE to its file as one chunk.
+ */
+static void trace_flush(trace_t *trace) {
+    trace_file_t *file = trace->file;
+    int header[3];
+    if (trace->len == 0) return;
+    header[0] = trace->direction;
+    header[1] = trace->thread_id;
+    header[2] = trace->len;
+    pthread_mutex_lock(&file->mutex);
+    if (fwrite(header, sizeof(int), 3, file->out) != 3 ||
+        fwrite(trace->events, sizeof(trace_event_t), (size_t) trace->len, file->out) !=
+        (size_t) trace->len)
+        file->ok = 0;
+    pthread_mutex_unlock(&file->mutex);
+    trace->len = 0;
+}
+
+/**
+ * Create the trace file FILENAME for a maze of ROWS x COLS and start its
+ *   clock. Returns the pointer to the file, NULL if it cannot be created.
+ */
+trace_file_t *trace_file_init(const char *filename, int rows, int cols) {
+    trace_file_t *file = malloc(sizeof(trace_file_t));
+    int header[3];
+    assert(file != NULL);
+    file->out = fopen(filename, "wb");
+    if (file->out == NULL) {
+        free(file);
+        return NULL;
+    }
+    header[0] = TRACE_MAGIC;
+    header[1] = rows;
+    header[2] = cols;
+    file->ok = fwrite(header, sizeof(int), 3, file->out) == 3;
+    if (pthread_mutex_init(&file->mutex, NULL) != 0) {
+        fclose(file->out);
+        free(file);
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &file->start);
+    return file;
+}
+
+/**
+ * Close FILE, once the buffers of all threads are destroyed. Returns 0 if
+ *   the whole trace was written, -1 if not.
+ */
+int trace_file_destroy(trace_file_t *file) {
+    int ok = file->ok;
+    if (fclose(file->out) != 0) ok = 0;
+    pthread_mutex_destroy(&file->mutex);
+    free(file);
+    return ok ? 0 : -1;
+}
+
+/**
+ * Initialize the buffer of thread THREAD_ID of DIRECTION, recording into
+ *   FILE. Returns the pointer to the new buffer.
+ */
+trace_t *trace_init(trace_file_t *file, int direction, int thread_id) {
+    trace_t *trace = malloc(sizeof(trace_t));
+    assert(trace != NULL);
+    trace->file = file;
+    trace->direction = direction;
+    trace->thread_id = thread_id;
+    trace->len = 0;
+    return trace;
+}
+
+/**
+ * Nanoseconds since the trace of TRACE started.
+ */
+unsigned long trace_clock(const trace_t *trace) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long) (now.tv_sec - trace->file->start.tv_sec) * 1000000000UL +
+           (unsigned long) now.tv_nsec - (unsigned long) trace->file->start.tv_nsec;
+}
+
+/**
+ * Record EVENT at NS with cell (X, Y), GS, FS and OPEN into TRACE, flushing
+ *   the buffer first if it is full. Only the owning thread may call it.
+ */
+void trace_record(trace_t *trace, unsigned long ns, int event, int x, int y, int gs, int fs,
+                  int open) {
+    trace_event_t *e;
+    if (trace->len == TRACE_BUFFER_SIZE) trace_flush(trace);
+    e = &trace->events[trace->len++];
+    e->ns = ns;
+    e->event = event;
+    e->x = x;
+    e->y = y;
+    e->gs = gs;
+    e->fs = fs;
+    e->open = open;
+}
+
+/**
+ * Flush the remaining events of TRACE and delete its memory.
+ */
+void trace_destroy(trace_t *trace) {
+    trace_flush(trace);
+    free(trace);
+}
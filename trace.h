@@ -0,0 +1,80 @@
+/**
+ * File: trace.h
+ *
+ *   Declaration of the search trace recorder and of its file format, read
+ *     back by the replay tool. Every HDA* thread records its events into a
+ *     buffer of its own, with no locking; a full buffer is appended to the
+ *     shared trace file as one chunk, so the file holds the whole search.
+ *
+ *     File: int[3] header { TRACE_MAGIC, rows, cols }, then chunks of an
+ *     int[3] header { direction, thread id, event count } followed by that
+ *     many trace_event_t. Chunks of one thread are in order.
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdio.h>      /* FILE */
+#include <pthread.h>
+#include <time.h>       /* struct timespec */
+
+#define TRACE_MAGIC             (0x43525448)    /* "HTRC" */
+#define TRACE_BUFFER_SIZE       (0x4000)
+
+/* Events, with the meaning of X, Y, GS and FS. */
+#define TRACE_BEGIN             (0)     /* Round started, no cell. */
+#define TRACE_END               (1)     /* Round ended, no cell. */
+#define TRACE_EXPAND            (2)     /* Cell expanded, its g and f. */
+#define TRACE_SEND              (3)     /* Cell sent with g, FS the owner. */
+#define TRACE_RECEIVE           (4)     /* Cell received with g, FS the latency in ns. */
+#define TRACE_IDLE              (5)     /* Out of work, no cell. */
+#define TRACE_BUSY              (6)     /* Messages arrived, no cell. */
+#define TRACE_EVENT_NUM         (7)
+
+
+typedef struct trace_event_t {
+    unsigned long ns;       /* Nanoseconds since the trace started. */
+    int event;
+    int x;
+    int y;
+    int gs;
+    int fs;
+    int open;               /* Open nodes of the thread after the event. */
+} trace_event_t;
+
+/**
+ * Trace file shared by all threads of a search.
+ */
+typedef struct trace_file_t {
+    FILE *out;
+    pthread_mutex_t mutex;  /* Serializes chunks. */
+    struct timespec start;
+    int ok;                 /* No write failed so far. */
+} trace_file_t;
+
+/**
+ * Event buffer of one thread.
+ */
+typedef struct trace_t {
+    trace_file_t *file;
+    int direction;          /* 0 from the start, 1 from the goal. */
+    int thread_id;
+    int len;
+    trace_event_t events[TRACE_BUFFER_SIZE];
+} trace_t;
+
+/* Function prototypes. */
+trace_file_t *trace_file_init(const char *filename, int rows, int cols);
+
+int trace_file_destroy(trace_file_t *file);
+
+trace_t *trace_init(trace_file_t *file, int direction, int thread_id);
+
+unsigned long trace_clock(const trace_t *trace);
+
+void trace_record(trace_t *trace, unsigned long ns, int event, int x, int y, int gs, int fs,
+                  int open);
+
+void trace_destroy(trace_t *trace);
+
+#endif